@@ -0,0 +1,289 @@
+"""
+Smart Garden System - Compact Action Log
+
+Append-only binary log of pump commands and device acknowledgements, with
+an in-memory index by device and time. Each ingest shard owns one log (its
+devices never appear in another shard's log), so appends take no locks.
+
+Record layout (25 bytes, little-endian):
+    uint64 ts_ms | uint64 trace_id | uint32 device | uint16 duration |
+    uint8 action | uint8 reason_code | uint8 zone
+
+Devices are interned to a uint32 index; the mapping lives in a sidecar
+text file next to the log. The writer also checkpoints the time index to
+'<path>.index' every CHECKPOINT_RECORDS appends and on close, so opening a
+log only has to scan the records written since the last checkpoint. Pump cycles are reconstructed by joining
+WATER_ON commands with the device's ON/OFF acks (pumpStatus transitions in
+telemetry), matched by the trace ID the device echoes back.
+
+Only the owning shard opens a log for writing; that is where a torn tail
+left by a crash is repaired. Queries against a live log from anywhere else
+open it with read_only=True, which ignores a partial trailing record
+instead of truncating it.
+"""
+
+import os
+import struct
+from array import array
+from bisect import bisect_left, bisect_right
+
+from lambda_garden_automation import REASON_MANUAL
+
+ACTION_LOG_DIR = os.environ.get('ACTION_LOG_DIR', 'action-log')
+CHECKPOINT_RECORDS = int(os.environ.get('ACTION_LOG_CHECKPOINT_RECORDS', '10000'))
+
+# Record kinds
+WATER_ON = 1
+WATER_OFF = 2
+ACK_ON = 3
+ACK_OFF = 4
+
+ACTION_CODES = {'WATER_ON': WATER_ON, 'WATER_OFF': WATER_OFF}
+ACTION_NAMES = {WATER_ON: 'WATER_ON', WATER_OFF: 'WATER_OFF',
+                ACK_ON: 'ACK_ON', ACK_OFF: 'ACK_OFF'}
+
+RECORD = struct.Struct('<QQIHBBB')
+# Index checkpoint: indexed log size and device count, then per device its
+# index and entry count followed by the timestamps and offsets arrays
+CHECKPOINT_HEADER = struct.Struct('<QI')
+CHECKPOINT_DEVICE = struct.Struct('<II')
+
+
+class ActionLog:
+    """
+    One shard's action log
+
+    Args:
+        path: Log file path; '<path>.devices' holds the device table and
+            '<path>.index' the index checkpoint
+        read_only: Open for queries only, leaving the file untouched
+    """
+
+    def __init__(self, path, read_only=False):
+        self.path = path
+        self.devices_path = path + '.devices'
+        self.checkpoint_path = path + '.index'
+        self.read_only = read_only
+        self.device_ids = []
+        self.device_index = {}
+        self.index = {}  # device index -> (timestamps array, offsets array)
+
+        if read_only:
+            self.fd = os.open(path, os.O_RDONLY)
+        else:
+            os.makedirs(os.path.dirname(path) or '.', exist_ok=True)
+            self.fd = os.open(path, os.O_RDWR | os.O_CREAT | os.O_APPEND, 0o644)
+        # Devices are interned before their first record is written, so
+        # loading the table after opening covers every indexed record
+        self._load_devices()
+        self.size = self._rebuild_index()
+        self.checkpointed = self.size
+
+    @classmethod
+    def for_shard(cls, shard_id, log_dir=ACTION_LOG_DIR, read_only=False):
+        return cls(os.path.join(log_dir, f'shard-{shard_id}.log'), read_only)
+
+    def _load_devices(self):
+        if not os.path.exists(self.devices_path):
+            return
+        with open(self.devices_path) as f:
+            for line in f:
+                device_id = line.rstrip('\n')
+                self.device_index[device_id] = len(self.device_ids)
+                self.device_ids.append(device_id)
+
+    def _rebuild_index(self):
+        size = os.fstat(self.fd).st_size
+        # A partial record is either torn by a crash mid-append (the writer
+        # drops it) or still being written (readers just stop before it)
+        size -= size % RECORD.size
+        if not self.read_only:
+            os.ftruncate(self.fd, size)
+
+        start = self._load_checkpoint(size)
+        data = os.pread(self.fd, size - start, start)
+        for offset in range(0, size - start, RECORD.size):
+            ts_ms, _, device, _, _, _, _ = RECORD.unpack_from(data, offset)
+            self._index_record(device, ts_ms, start + offset)
+        return size
+
+    def _load_checkpoint(self, size):
+        """
+        Load the index checkpoint if it still describes this log
+
+        Returns:
+            int: Log offset the checkpoint covers up to (0 if none was used)
+        """
+        try:
+            with open(self.checkpoint_path, 'rb') as f:
+                data = f.read()
+            indexed, count = CHECKPOINT_HEADER.unpack_from(data)
+            if indexed > size:
+                return 0  # Log is shorter than the checkpoint; don't trust it
+            position = CHECKPOINT_HEADER.size
+            index = {}
+            for _ in range(count):
+                device, entries = CHECKPOINT_DEVICE.unpack_from(data, position)
+                position += CHECKPOINT_DEVICE.size
+                timestamps, offsets = array('Q'), array('Q')
+                timestamps.frombytes(data[position:position + entries * 8])
+                position += entries * 8
+                offsets.frombytes(data[position:position + entries * 8])
+                position += entries * 8
+                if len(offsets) != entries:
+                    return 0
+                index[device] = (timestamps, offsets)
+        except (OSError, struct.error):
+            return 0
+        self.index = index
+        return indexed
+
+    def checkpoint(self):
+        """Write the current index to the checkpoint file"""
+        parts = [CHECKPOINT_HEADER.pack(self.size, len(self.index))]
+        for device, (timestamps, offsets) in self.index.items():
+            parts.append(CHECKPOINT_DEVICE.pack(device, len(timestamps)))
+            parts.append(timestamps.tobytes())
+            parts.append(offsets.tobytes())
+        # Replace atomically so a crash never leaves a torn checkpoint
+        tmp_path = self.checkpoint_path + '.tmp'
+        with open(tmp_path, 'wb') as f:
+            f.write(b''.join(parts))
+        os.replace(tmp_path, self.checkpoint_path)
+        self.checkpointed = self.size
+
+    def _index_record(self, device, ts_ms, offset):
+        timestamps, offsets = self.index.setdefault(device, (array('Q'), array('Q')))
+        if not timestamps or ts_ms >= timestamps[-1]:
+            timestamps.append(ts_ms)
+            offsets.append(offset)
+        else:
+            # Rare out-of-order append; keep the index sorted by time
+            position = bisect_right(timestamps, ts_ms)
+            timestamps.insert(position, ts_ms)
+            offsets.insert(position, offset)
+
+    def _intern(self, device_id):
+        device = self.device_index.get(device_id)
+        if device is None:
+            device = len(self.device_ids)
+            with open(self.devices_path, 'a') as f:
+                f.write(device_id + '\n')
+            self.device_index[device_id] = device
+            self.device_ids.append(device_id)
+        return device
+
+    def append(self, device_id, kind, ts_ms, duration=0, reason_code=REASON_MANUAL,
+               zone=0, trace_id=0):
+        """
+        Append one command or ack record
+
+        Args:
+            device_id: Device identifier
+            kind: WATER_ON, WATER_OFF, ACK_ON or ACK_OFF
+            ts_ms: Event time (epoch ms)
+            duration: Commanded duration in seconds
+            reason_code: REASON_* code from the decision
+            zone: Zone number
+            trace_id: Command trace ID (0 if unknown)
+        """
+        if self.read_only:
+            raise ValueError(f"{self.path} is open read-only")
+        device = self._intern(device_id)
+        offset = self.size
+        os.write(self.fd, RECORD.pack(ts_ms, trace_id, device, duration,
+                                      kind, reason_code & 0xFF, zone))
+        self.size += RECORD.size
+        self._index_record(device, ts_ms, offset)
+        if self.size - self.checkpointed >= CHECKPOINT_RECORDS * RECORD.size:
+            self.checkpoint()
+
+    def records(self, device_id, start_ms=0, end_ms=2**64 - 1):
+        """
+        Yield a device's records in time order
+
+        Yields:
+            dict: ts_ms, trace_id, duration, action, reason_code, zone
+        """
+        device = self.device_index.get(device_id)
+        if device is None or device not in self.index:
+            return
+
+        timestamps, offsets = self.index[device]
+        first = bisect_left(timestamps, start_ms)
+        last = bisect_right(timestamps, end_ms)
+        for position in range(first, last):
+            data = os.pread(self.fd, RECORD.size, offsets[position])
+            ts_ms, trace_id, _, duration, kind, reason_code, zone = RECORD.unpack(data)
+            yield {
+                'ts_ms': ts_ms,
+                'trace_id': trace_id,
+                'duration': duration,
+                'action': kind,
+                'reason_code': reason_code,
+                'zone': zone
+            }
+
+    def pump_cycles(self, device_id, start_ms=0, end_ms=2**64 - 1):
+        """
+        Reconstruct actual pump runs for a device
+
+        Each ACK_ON opens a cycle that the next ACK_OFF closes. The cycle is
+        attributed to the WATER_ON with the same trace ID, or failing that
+        the most recent WATER_ON before it. Commands that never produced an
+        ack are reported with started_ms None.
+
+        Returns:
+            list: One dict per cycle or unacknowledged command
+        """
+        cycles = []
+        commands = {}     # trace_id -> command record
+        last_command = None
+        open_cycle = None
+
+        for record in self.records(device_id, start_ms, end_ms):
+            kind = record['action']
+
+            if kind == WATER_ON:
+                if last_command is not None and not last_command.get('acked'):
+                    cycles.append(self._cycle(last_command, None, None))
+                commands[record['trace_id']] = record
+                last_command = record
+
+            elif kind == ACK_ON and open_cycle is None:
+                command = commands.get(record['trace_id']) or last_command
+                if command is not None:
+                    command['acked'] = True
+                open_cycle = (command, record['ts_ms'])
+
+            elif kind == ACK_OFF and open_cycle is not None:
+                command, started_ms = open_cycle
+                cycles.append(self._cycle(command, started_ms, record['ts_ms']))
+                open_cycle = None
+
+        if open_cycle is not None:
+            command, started_ms = open_cycle
+            cycles.append(self._cycle(command, started_ms, None))
+        elif last_command is not None and not last_command.get('acked'):
+            cycles.append(self._cycle(last_command, None, None))
+
+        return cycles
+
+    @staticmethod
+    def _cycle(command, started_ms, ended_ms):
+        return {
+            'commanded_ms': command['ts_ms'] if command else None,
+            'commanded_duration': command['duration'] if command else None,
+            'reason_code': command['reason_code'] if command else None,
+            'zone': command['zone'] if command else 0,
+            'trace_id': command['trace_id'] if command else 0,
+            'started_ms': started_ms,
+            'ended_ms': ended_ms,
+            'actual_seconds': (ended_ms - started_ms) / 1000
+                              if started_ms is not None and ended_ms is not None else None
+        }
+
+    def close(self):
+        if not self.read_only and self.size != self.checkpointed:
+            self.checkpoint()
+        os.close(self.fd)
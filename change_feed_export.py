@@ -0,0 +1,376 @@
+"""
+Smart Garden System - Incremental Change-Feed Export
+
+Consumes the GardenSensorData DynamoDB stream instead of re-scanning the
+table every night. Triggered hourly by EventBridge, each run reads new
+records after the persisted watermark and appends them to the day's output
+as a chunk object, so exported data lags by at most an hour. At the end of
+the day a 'finalize' run stitches the chunks into the daily CSV and writes
+the summary. Records that arrive after their day was finalized (devices
+uploading history after an outage) re-finalize that day, merging the new
+chunks into the existing CSV.
+
+EventBridge inputs:
+    {}                          - hourly: poll the change feed
+    {"action": "finalize"}      - daily: finalize yesterday's export
+"""
+
+import codecs
+import csv
+import hashlib
+import json
+import os
+import boto3
+from datetime import datetime, timedelta
+from io import StringIO
+from boto3.dynamodb.types import TypeDeserializer
+
+from data_export_lambda import (
+    BUCKET_NAME, TABLE_NAME, FIELDNAMES, MultipartCsvUpload, SummaryStats,
+    generate_summary
+)
+
+dynamodb = boto3.resource('dynamodb')
+streams_client = boto3.client('dynamodbstreams')
+s3_client = boto3.client('s3')
+
+WATERMARK_KEY = 'garden-data/_state/watermark.json'
+# Watermark value for a closed shard that has been read to its end
+SHARD_DONE = 'done'
+LATE_DAYS_KEY = 'garden-data/_state/late_days.json'
+
+# Streams can return empty pages in the middle of a shard; an open shard
+# counts as caught up only after this many empty pages in a row
+MAX_EMPTY_PAGES = int(os.environ.get('STREAM_MAX_EMPTY_PAGES', '10'))
+
+deserializer = TypeDeserializer()
+
+
+def lambda_handler(event, context):
+    if event.get('action') == 'finalize':
+        yesterday = datetime.now() - timedelta(days=1)
+        # Pick up anything that arrived since the last hourly run first
+        poll_change_feed()
+        return finalize_day(yesterday.strftime('%Y-%m-%d'))
+
+    return poll_change_feed()
+
+
+def day_prefix(date_str):
+    return f"garden-data/{date_str[:4]}/{date_str[5:7]}/{date_str}"
+
+
+def record_day(item):
+    """The item's 'YYYY-MM-DD' day, or None if its timestamp doesn't parse"""
+    date_str = str(item.get('timestamp', ''))[:10]
+    try:
+        datetime.strptime(date_str, '%Y-%m-%d')
+    except ValueError:
+        return None
+    return date_str
+
+
+def chunk_run_id(chunk_key):
+    return chunk_key.rsplit('/', 1)[-1][:-len('.csv')]
+
+
+def merged_run_ids(date_str):
+    """
+    Chunk run IDs already stitched into a day's CSV
+
+    Returns:
+        set: Run IDs, or None if the day has not been finalized
+    """
+    try:
+        response = s3_client.head_object(Bucket=BUCKET_NAME, Key=f"{day_prefix(date_str)}.csv")
+    except s3_client.exceptions.ClientError as e:
+        if e.response['Error']['Code'] in ('404', 'NoSuchKey', 'NotFound'):
+            return None
+        raise
+    parts = response.get('Metadata', {}).get('parts', '')
+    return set(parts.split(',')) if parts else set()
+
+
+def load_watermark():
+    """
+    Load the last consumed sequence number per stream shard
+
+    Returns:
+        dict: shardId -> sequence number (SHARD_DONE once a closed shard
+            has been read to its end)
+    """
+    try:
+        response = s3_client.get_object(Bucket=BUCKET_NAME, Key=WATERMARK_KEY)
+        return json.loads(response['Body'].read())
+    except s3_client.exceptions.NoSuchKey:
+        return {}
+
+
+def save_watermark(watermark):
+    s3_client.put_object(
+        Bucket=BUCKET_NAME,
+        Key=WATERMARK_KEY,
+        Body=json.dumps(watermark, sort_keys=True),
+        ContentType='application/json'
+    )
+
+
+def load_late_days():
+    """Finalized days with late chunks still to merge"""
+    try:
+        response = s3_client.get_object(Bucket=BUCKET_NAME, Key=LATE_DAYS_KEY)
+        return set(json.loads(response['Body'].read()))
+    except s3_client.exceptions.NoSuchKey:
+        return set()
+
+
+def save_late_days(days):
+    s3_client.put_object(
+        Bucket=BUCKET_NAME,
+        Key=LATE_DAYS_KEY,
+        Body=json.dumps(sorted(days)),
+        ContentType='application/json'
+    )
+
+
+def list_shards(stream_arn):
+    """All shards of the stream, parents before their children"""
+    shards = []
+    kwargs = {'StreamArn': stream_arn}
+    while True:
+        description = streams_client.describe_stream(**kwargs)['StreamDescription']
+        shards.extend(description['Shards'])
+        last = description.get('LastEvaluatedShardId')
+        if not last:
+            break
+        kwargs['ExclusiveStartShardId'] = last
+
+    # Records for a key move from parent to child shard on a split, so
+    # consume parents first to keep per-key ordering
+    ordered, seen = [], set()
+    pending = list(shards)
+    known = {shard['ShardId'] for shard in shards}
+    while pending:
+        remaining = []
+        for shard in pending:
+            parent = shard.get('ParentShardId')
+            if parent is None or parent not in known or parent in seen:
+                ordered.append(shard)
+                seen.add(shard['ShardId'])
+            else:
+                remaining.append(shard)
+        if len(remaining) == len(pending):
+            ordered.extend(remaining)
+            break
+        pending = remaining
+    return ordered
+
+
+def read_shard(stream_arn, shard_id, after_sequence):
+    """
+    Read every available record in a shard after a sequence number
+
+    A closed shard is read until the stream stops handing out iterators;
+    an open one until MAX_EMPTY_PAGES empty pages in a row.
+
+    Returns:
+        tuple: (list of new item images, last sequence number read,
+            True if the shard is closed and fully read)
+    """
+    if after_sequence:
+        iterator_kwargs = {'ShardIteratorType': 'AFTER_SEQUENCE_NUMBER',
+                           'SequenceNumber': after_sequence}
+    else:
+        iterator_kwargs = {'ShardIteratorType': 'TRIM_HORIZON'}
+
+    iterator = streams_client.get_shard_iterator(
+        StreamArn=stream_arn, ShardId=shard_id, **iterator_kwargs
+    )['ShardIterator']
+
+    items = []
+    last_sequence = after_sequence
+    empty_pages = 0
+    while iterator:
+        response = streams_client.get_records(ShardIterator=iterator, Limit=1000)
+        records = response.get('Records', [])
+
+        for record in records:
+            last_sequence = record['dynamodb']['SequenceNumber']
+            image = record['dynamodb'].get('NewImage')
+            if record['eventName'] in ('INSERT', 'MODIFY') and image:
+                items.append({k: deserializer.deserialize(v) for k, v in image.items()})
+
+        iterator = response.get('NextShardIterator')
+        empty_pages = 0 if records else empty_pages + 1
+        if empty_pages >= MAX_EMPTY_PAGES:
+            break
+
+    return items, last_sequence, iterator is None
+
+
+def poll_change_feed():
+    """
+    Append new stream records to each day's output as chunk objects
+
+    Chunk keys are derived from the starting watermark, so a run that
+    crashes before saving the watermark is simply redone and overwrites
+    the same chunks rather than duplicating rows.
+    """
+    stream_arn = dynamodb.Table(TABLE_NAME).latest_stream_arn
+    if not stream_arn:
+        print(f"⚠️  No stream enabled on {TABLE_NAME}")
+        return {'statusCode': 500, 'body': 'Stream not enabled'}
+
+    watermark = load_watermark()
+    run_id = hashlib.sha1(json.dumps(watermark, sort_keys=True).encode()).hexdigest()[:16]
+
+    rows_by_day = {}
+    skipped = 0
+    shards = list_shards(stream_arn)
+    # Shards past the stream's 24h retention are no longer listed
+    listed = {shard['ShardId'] for shard in shards}
+    new_watermark = {k: v for k, v in watermark.items() if k in listed}
+    for shard in shards:
+        shard_id = shard['ShardId']
+        if watermark.get(shard_id) == SHARD_DONE:
+            continue
+        items, last_sequence, finished = read_shard(stream_arn, shard_id,
+                                                    watermark.get(shard_id))
+        if finished:
+            new_watermark[shard_id] = SHARD_DONE
+        elif last_sequence:
+            new_watermark[shard_id] = last_sequence
+        for item in items:
+            date_str = record_day(item)
+            if date_str is None:
+                skipped += 1
+                print(f"⚠️  Skipping record with bad timestamp: "
+                      f"{item.get('deviceId')} {item.get('timestamp')!r}")
+                continue
+            rows_by_day.setdefault(date_str, []).append(item)
+
+    total = 0
+    for date_str, items in rows_by_day.items():
+        buffer = StringIO()
+        writer = csv.DictWriter(buffer, fieldnames=FIELDNAMES, extrasaction='ignore')
+        writer.writerows(items)
+
+        s3_client.put_object(
+            Bucket=BUCKET_NAME,
+            Key=f"{day_prefix(date_str)}/parts/{run_id}.csv",
+            Body=buffer.getvalue(),
+            ContentType='text/csv'
+        )
+        total += len(items)
+
+    # Late records for an already finalized day are merged into its CSV.
+    # The days are noted before the watermark moves and merged after it
+    # (a chunk is rewritten until then), so a crash leaves them pending
+    # for the next run instead of orphaning their chunks.
+    pending = load_late_days()
+    late_days = {d for d in rows_by_day if merged_run_ids(d) is not None}
+    if late_days - pending:
+        pending |= late_days
+        save_late_days(pending)
+
+    # Only advance the watermark once the chunks are durable
+    if new_watermark != watermark:
+        save_watermark(new_watermark)
+
+    late_days = sorted(pending)
+    for date_str in late_days:
+        finalize_day(date_str)
+    if late_days:
+        save_late_days(set())
+
+    print(f"Appended {total} records across {len(rows_by_day)} day(s)"
+          f"{f', re-finalized {len(late_days)}' if late_days else ''}"
+          f"{f', skipped {skipped} with bad timestamps' if skipped else ''}")
+    return {
+        'statusCode': 200,
+        'body': json.dumps({
+            'records_appended': total,
+            'records_skipped': skipped,
+            'days': sorted(rows_by_day),
+            'days_refinalized': late_days
+        })
+    }
+
+
+def finalize_day(date_str):
+    """
+    Stitch a day's chunks into the daily CSV and write the summary
+
+    Streams chunk objects through a multipart upload, so memory stays
+    bounded regardless of how much data the day produced. If the day was
+    finalized before, its existing CSV is streamed in first and only the
+    chunks it doesn't already hold are added. The run IDs of the chunks
+    merged are kept in the CSV's metadata until the chunks are deleted.
+    """
+    prefix = f"{day_prefix(date_str)}/parts/"
+    chunk_keys = []
+    paginator = s3_client.get_paginator('list_objects_v2')
+    for page in paginator.paginate(Bucket=BUCKET_NAME, Prefix=prefix):
+        chunk_keys.extend(obj['Key'] for obj in page.get('Contents', []))
+
+    merged = merged_run_ids(date_str)
+    new_keys = [key for key in chunk_keys if chunk_run_id(key) not in (merged or ())]
+
+    if not new_keys:
+        # Left over from a run that stopped before deleting them
+        for chunk_key in chunk_keys:
+            s3_client.delete_object(Bucket=BUCKET_NAME, Key=chunk_key)
+        print(f"No new data for {date_str}")
+        return {'statusCode': 200, 'body': 'No data'}
+
+    s3_key = f"{day_prefix(date_str)}.csv"
+    upload = MultipartCsvUpload(
+        s3_client, BUCKET_NAME, s3_key,
+        metadata={'parts': ','.join(chunk_run_id(key) for key in new_keys)}
+    )
+    stats = SummaryStats()
+
+    try:
+        if merged is not None:
+            copy_finalized_rows(s3_key, upload, stats)
+        for chunk_key in new_keys:
+            body = s3_client.get_object(Bucket=BUCKET_NAME, Key=chunk_key)['Body'].read()
+            for row in csv.DictReader(StringIO(body.decode('utf-8')), fieldnames=FIELDNAMES):
+                stats.add(row)
+            upload.add_tail(body)
+        upload.complete()
+    except Exception:
+        upload.abort()
+        raise
+
+    for chunk_key in chunk_keys:
+        s3_client.delete_object(Bucket=BUCKET_NAME, Key=chunk_key)
+
+    print(f"Finalized {stats.count} records to s3://{BUCKET_NAME}/{s3_key}"
+          f"{' (re-finalized with late records)' if merged is not None else ''}")
+    generate_summary(stats, date_str)
+
+    return {
+        'statusCode': 200,
+        'body': json.dumps({
+            'records_exported': stats.count,
+            's3_location': f's3://{BUCKET_NAME}/{s3_key}'
+        })
+    }
+
+
+def copy_finalized_rows(s3_key, upload, stats):
+    """Stream an existing daily CSV's rows (without its header) into upload"""
+    body = s3_client.get_object(Bucket=BUCKET_NAME, Key=s3_key)['Body']
+    buffer = StringIO()
+    writer = csv.DictWriter(buffer, fieldnames=FIELDNAMES, extrasaction='ignore')
+
+    for row in csv.DictReader(codecs.getreader('utf-8')(body)):
+        writer.writerow(row)
+        stats.add(row)
+        if buffer.tell() >= upload.part_size:
+            upload.add_tail(buffer.getvalue().encode('utf-8'))
+            buffer.seek(0)
+            buffer.truncate()
+
+    upload.add_tail(buffer.getvalue().encode('utf-8'))
@@ -1,121 +1,294 @@
 import json
 import boto3
 import csv
+import os
+import threading
+from concurrent.futures import ThreadPoolExecutor
 from datetime import datetime, timedelta
 from io import StringIO
+from boto3.dynamodb.conditions import Attr
 
-dynamodb = boto3.resource('dynamodb')
 s3_client = boto3.client('s3')
 
 BUCKET_NAME = 'garden-data-analytics'
 TABLE_NAME = 'GardenSensorData'
 
+# Parallel scan segments (one worker thread each)
+SCAN_SEGMENTS = int(os.environ.get('EXPORT_SCAN_SEGMENTS', '8'))
+
+# Multipart part size; S3 requires at least 5 MB for all but the last part
+PART_SIZE = int(os.environ.get('EXPORT_PART_SIZE', str(8 * 1024 * 1024)))
+
+FIELDNAMES = ['timestamp', 'deviceId', 'soilMoisture',
+              'moisturePercent', 'pumpStatus']
+
+# boto3 resources are not thread-safe, so each scan worker gets its own
+_worker = threading.local()
+
+
+def worker_table():
+    """This thread's GardenSensorData Table, from its own boto3 session"""
+    table = getattr(_worker, 'table', None)
+    if table is None:
+        table = boto3.session.Session().resource('dynamodb').Table(TABLE_NAME)
+        _worker.table = table
+    return table
+
+
 def lambda_handler(event, context):
     """
     Export yesterday's garden data to S3 as CSV
     Triggered daily by EventBridge
     """
-    
+
     # Get yesterday's date
     yesterday = datetime.now() - timedelta(days=1)
     date_str = yesterday.strftime('%Y-%m-%d')
-    
-    # Query DynamoDB
-    table = dynamodb.Table(TABLE_NAME)
-    
-    items = []
-    last_key = None
-    
-    while True:
-        if last_key:
-            response = table.scan(
-                ExclusiveStartKey=last_key
-            )
-        else:
-            response = table.scan()
-        
-        items.extend(response.get('Items', []))
-        
-        last_key = response.get('LastEvaluatedKey')
-        if not last_key:
-            break
-    
-    # Filter for yesterday's data
-    filtered_items = [
-        item for item in items 
-        if item.get('timestamp', '').startswith(date_str)
-    ]
-    
-    if not filtered_items:
-        print(f"No data for {date_str}")
-        return {'statusCode': 200, 'body': 'No data'}
-    
-    # Convert to CSV
-    csv_buffer = StringIO()
-    
-    fieldnames = ['timestamp', 'deviceId', 'soilMoisture', 
-                  'moisturePercent', 'pumpStatus']
-    
-    writer = csv.DictWriter(csv_buffer, fieldnames=fieldnames)
-    writer.writeheader()
-    
-    for item in filtered_items:
-        writer.writerow({
-            'timestamp': item.get('timestamp'),
-            'deviceId': item.get('deviceId'),
-            'soilMoisture': item.get('soilMoisture'),
-            'moisturePercent': item.get('moisturePercent'),
-            'pumpStatus': item.get('pumpStatus')
-        })
-    
-    # Upload to S3
+
     s3_key = f"garden-data/{yesterday.year}/{yesterday.month:02d}/{date_str}.csv"
-    
-    s3_client.put_object(
-        Bucket=BUCKET_NAME,
-        Key=s3_key,
-        Body=csv_buffer.getvalue(),
-        ContentType='text/csv'
+
+    stats = export_day(
+        date_str,
+        table=worker_table,
+        s3=s3_client,
+        bucket=BUCKET_NAME,
+        key=s3_key
     )
-    
-    print(f"Exported {len(filtered_items)} records to s3://{BUCKET_NAME}/{s3_key}")
-    
+
+    if stats.count == 0:
+        print(f"No data for {date_str}")
+        return {'statusCode': 200, 'body': 'No data'}
+
+    print(f"Exported {stats.count} records to s3://{BUCKET_NAME}/{s3_key}")
+
     # Generate summary stats
-    generate_summary(filtered_items, date_str)
-    
+    generate_summary(stats, date_str)
+
     return {
         'statusCode': 200,
         'body': json.dumps({
-            'records_exported': len(filtered_items),
+            'records_exported': stats.count,
             's3_location': f's3://{BUCKET_NAME}/{s3_key}'
         })
     }
 
-def generate_summary(items, date):
+
+def export_day(date_str, table, s3, bucket, key, segments=SCAN_SEGMENTS, part_size=PART_SIZE):
+    """
+    Export one day of sensor data as a single CSV object
+
+    The table is read with a parallel segmented scan; each segment worker
+    encodes its rows and streams them into a shared multipart upload, so
+    memory stays bounded by roughly one part per worker.
+
+    Args:
+        date_str: Day to export ('YYYY-MM-DD')
+        table: Callable returning a DynamoDB Table (or stand-in with a
+            compatible scan()) for the calling worker thread
+        s3: S3 client (or stand-in with the multipart upload calls)
+        bucket: Destination bucket
+        key: Destination object key
+        segments: Number of parallel scan segments
+        part_size: Multipart part size in bytes
+
+    Returns:
+        SummaryStats: Merged statistics for the exported rows
+    """
+    upload = MultipartCsvUpload(s3, bucket, key, part_size)
+
+    try:
+        with ThreadPoolExecutor(max_workers=segments) as pool:
+            results = list(pool.map(
+                lambda segment: export_segment(table(), date_str, segment, segments, upload),
+                range(segments)
+            ))
+    except Exception:
+        upload.abort()
+        raise
+
+    stats = SummaryStats()
+    for segment_stats in results:
+        stats.merge(segment_stats)
+
+    if stats.count == 0:
+        upload.abort()
+    else:
+        upload.complete()
+
+    return stats
+
+
+def export_segment(table, date_str, segment, total_segments, upload):
+    """Scan one segment for the day's rows and stream them to the upload"""
+    stats = SummaryStats()
+    buffer = StringIO()
+    writer = csv.DictWriter(buffer, fieldnames=FIELDNAMES, extrasaction='ignore')
+
+    scan_kwargs = {
+        'Segment': segment,
+        'TotalSegments': total_segments,
+        'FilterExpression': Attr('timestamp').begins_with(date_str)
+    }
+
+    while True:
+        response = table.scan(**scan_kwargs)
+
+        for item in response.get('Items', []):
+            writer.writerow(item)
+            stats.add(item)
+
+            if buffer.tell() >= upload.part_size:
+                upload.add_part(buffer.getvalue().encode('utf-8'))
+                buffer.seek(0)
+                buffer.truncate()
+
+        last_key = response.get('LastEvaluatedKey')
+        if not last_key:
+            break
+        scan_kwargs['ExclusiveStartKey'] = last_key
+
+    # Whatever is left is smaller than a part; it goes into the final part
+    upload.add_tail(buffer.getvalue().encode('utf-8'))
+    return stats
+
+
+class MultipartCsvUpload:
+    """
+    One S3 multipart upload fed concurrently by several segment workers
+
+    The CSV header is prepended to whichever part is uploaded first (part
+    number 1). Sub-part-size leftovers from each worker are collected and
+    uploaded together as the last part. Optional metadata is stored on the
+    finished object.
+    """
+
+    def __init__(self, s3, bucket, key, part_size=PART_SIZE, metadata=None):
+        self.s3 = s3
+        self.bucket = bucket
+        self.key = key
+        self.part_size = part_size
+        self.lock = threading.Lock()
+        self.parts = []
+        self.tail = bytearray()
+        self.header_written = False
+        self.next_part_number = 1
+
+        header = StringIO()
+        csv.DictWriter(header, fieldnames=FIELDNAMES).writeheader()
+        self.header = header.getvalue().encode('utf-8')
+
+        self.upload_id = s3.create_multipart_upload(
+            Bucket=bucket,
+            Key=key,
+            ContentType='text/csv',
+            Metadata=metadata or {}
+        )['UploadId']
+
+    def add_part(self, data):
+        """Upload a full-size chunk of rows as its own part"""
+        with self.lock:
+            part_number = self.next_part_number
+            self.next_part_number += 1
+            if not self.header_written:
+                data = self.header + data
+                self.header_written = True
+
+        response = self.s3.upload_part(
+            Bucket=self.bucket,
+            Key=self.key,
+            UploadId=self.upload_id,
+            PartNumber=part_number,
+            Body=data
+        )
+
+        with self.lock:
+            self.parts.append({'PartNumber': part_number, 'ETag': response['ETag']})
+
+    def add_tail(self, data):
+        """Collect a worker's leftover rows for the final part"""
+        full = None
+        with self.lock:
+            self.tail += data
+            if len(self.tail) >= self.part_size:
+                full, self.tail = bytes(self.tail), bytearray()
+
+        if full is not None:
+            self.add_part(full)
+
+    def complete(self):
+        """Upload the collected tail as the last part and finish the object"""
+        if self.tail or not self.header_written:
+            self.add_part(bytes(self.tail))
+            self.tail = bytearray()
+
+        self.parts.sort(key=lambda part: part['PartNumber'])
+        self.s3.complete_multipart_upload(
+            Bucket=self.bucket,
+            Key=self.key,
+            UploadId=self.upload_id,
+            MultipartUpload={'Parts': self.parts}
+        )
+
+    def abort(self):
+        self.s3.abort_multipart_upload(
+            Bucket=self.bucket,
+            Key=self.key,
+            UploadId=self.upload_id
+        )
+
+
+class SummaryStats:
+    """Running daily statistics, mergeable across segment workers"""
+
+    def __init__(self):
+        self.count = 0
+        self.moisture_sum = 0.0
+        self.moisture_min = None
+        self.moisture_max = None
+        self.watering_events = 0
+
+    def add(self, item):
+        moisture = float(item.get('moisturePercent', 0))
+        self.count += 1
+        self.moisture_sum += moisture
+        self.moisture_min = moisture if self.moisture_min is None else min(self.moisture_min, moisture)
+        self.moisture_max = moisture if self.moisture_max is None else max(self.moisture_max, moisture)
+        if item.get('pumpStatus') == 'ON':
+            self.watering_events += 1
+
+    def merge(self, other):
+        if other.count == 0:
+            return
+        self.count += other.count
+        self.moisture_sum += other.moisture_sum
+        self.moisture_min = other.moisture_min if self.moisture_min is None else min(self.moisture_min, other.moisture_min)
+        self.moisture_max = other.moisture_max if self.moisture_max is None else max(self.moisture_max, other.moisture_max)
+        self.watering_events += other.watering_events
+
+
+def generate_summary(stats, date):
     """Generate daily summary statistics"""
-    
-    if not items:
+
+    if stats.count == 0:
         return
-    
-    moisture_values = [item['moisturePercent'] for item in items]
-    
+
     summary = {
         'date': date,
-        'total_readings': len(items),
-        'avg_moisture': sum(moisture_values) / len(moisture_values),
-        'min_moisture': min(moisture_values),
-        'max_moisture': max(moisture_values),
-        'watering_events': sum(1 for item in items if item.get('pumpStatus') == 'ON')
+        'total_readings': stats.count,
+        'avg_moisture': stats.moisture_sum / stats.count,
+        'min_moisture': stats.moisture_min,
+        'max_moisture': stats.moisture_max,
+        'watering_events': stats.watering_events
     }
-    
+
     # Save summary JSON
     s3_key = f"garden-summaries/{date}-summary.json"
-    
+
     s3_client.put_object(
         Bucket=BUCKET_NAME,
         Key=s3_key,
         Body=json.dumps(summary, indent=2),
         ContentType='application/json'
     )
-    
+
     print(f"Summary saved: {summary}")
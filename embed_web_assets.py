@@ -0,0 +1,57 @@
+"""
+Smart Garden System - Web Asset Embedder
+
+Gzips the on-device status page and writes it out as a C array in a
+header, so the firmware can serve it straight from flash with
+Content-Encoding: gzip (no decompression or copy on the device).
+
+Re-run after editing status_page.html:
+    python embed_web_assets.py [status_page.html] [status_page_html.h]
+"""
+
+import gzip
+import sys
+
+SOURCE = 'status_page.html'
+HEADER = 'status_page_html.h'
+
+
+def embed(source, header, symbol='STATUS_PAGE_GZ'):
+    """
+    Compress an asset and write it as a PROGMEM byte array
+
+    Returns:
+        tuple: (original size, compressed size)
+    """
+    with open(source, 'rb') as f:
+        raw = f.read()
+    # mtime=0 keeps the output byte-identical across rebuilds
+    compressed = gzip.compress(raw, compresslevel=9, mtime=0)
+
+    rows = [
+        '  ' + ', '.join(f'0x{b:02x}' for b in compressed[i:i + 16]) + ','
+        for i in range(0, len(compressed), 16)
+    ]
+    guard = header.upper().replace('.', '_').replace('/', '_')
+
+    with open(header, 'w') as f:
+        f.write(f'// Generated by embed_web_assets.py from {source} - do not edit\n\n')
+        f.write(f'#ifndef {guard}\n#define {guard}\n\n')
+        f.write('#include <Arduino.h>\n\n')
+        f.write(f'const uint8_t {symbol}[] PROGMEM = {{\n')
+        f.write('\n'.join(rows) + '\n};\n')
+        f.write(f'const size_t {symbol}_LEN = {len(compressed)};\n\n')
+        f.write(f'#endif  // {guard}\n')
+
+    return len(raw), len(compressed)
+
+
+def main():
+    source = sys.argv[1] if len(sys.argv) > 1 else SOURCE
+    header = sys.argv[2] if len(sys.argv) > 2 else HEADER
+    raw_size, compressed_size = embed(source, header)
+    print(f"✅ {source}: {raw_size} -> {compressed_size} bytes gzipped, written to {header}")
+
+
+if __name__ == '__main__':
+    main()
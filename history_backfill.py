@@ -0,0 +1,183 @@
+"""
+Smart Garden System - History Backfill
+
+Recovers readings the cloud missed from the device's on-board history
+buffer. request_history() sends a HISTORY command with a time range; the
+device streams compressed sample blocks on garden/history/<deviceId>,
+which an IoT Rule routes to the automation Lambda; lambda_handler hands
+them to handle_history_block() (see setup_script.sh). Each block is
+decoded, written to the sensor table and acknowledged with HISTORY_ACK.
+Blocks are handled by concurrent Lambda invocations in no fixed order, so
+an ack covers only its own block: the device slides its send window past
+blocks acknowledged without a gap and resends just the missing ones.
+
+Writes are idempotent (same deviceId + timestamp), so blocks the device
+resends after a lost ack are harmless. Backfilled items carry the
+device's sample time rather than the cloud receive time, so request only
+ranges that are actually missing.
+
+Usage:
+    python history_backfill.py <deviceId> <from ISO time> [<to ISO time>]
+"""
+
+import base64
+import json
+import random
+import struct
+import sys
+from datetime import datetime, timezone
+from decimal import Decimal
+
+from lambda_garden_automation import (
+    SENSOR_DATA_TABLE, SENSOR_DATA_TABLE_V2, dynamodb, iot_client
+)
+from storage_keys import iso_to_epoch_ms, to_v2_item
+
+COMMAND_TOPIC = 'garden/commands'
+
+# First sample of a block: uint32 time | uint16 raw | uint8 percent | uint8 flags
+FIRST_SAMPLE = struct.Struct('<IHBB')
+
+HISTORY_PUMP_ON = 0x01
+HISTORY_TIME_UPTIME = 0x02
+
+
+def _varint(data, pos):
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+def _unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode_block(data):
+    """
+    Decode one compressed history block
+
+    Args:
+        data: Block bytes (base64-decoded)
+
+    Returns:
+        list: (unix_time, soil_moisture_raw, moisture_percent, flags) per sample
+    """
+    if not data:
+        return []
+
+    samples = [FIRST_SAMPLE.unpack_from(data, 0)]
+    time, raw, percent, flags = samples[0]
+    pos = FIRST_SAMPLE.size
+
+    while pos < len(data):
+        delta_time, pos = _varint(data, pos)
+        delta_raw, pos = _varint(data, pos)
+        packed, pos = _varint(data, pos)
+        time += _unzigzag(delta_time)
+        raw += _unzigzag(delta_raw)
+        percent += _unzigzag(packed >> 2)
+        flags = packed & 0x03
+        samples.append((time, raw, percent, flags))
+
+    return samples
+
+
+def sample_item(device_id, sample):
+    """Sensor table item for a decoded sample (same shape as build_sensor_item)"""
+    time, raw, percent, flags = sample
+    return {
+        'deviceId': device_id,
+        # Naive UTC, like the timestamps Lambda writes with datetime.now()
+        'timestamp': datetime.fromtimestamp(time, timezone.utc).replace(tzinfo=None).isoformat(),
+        'soilMoisture': Decimal(raw),
+        'moisturePercent': Decimal(percent),
+        'pumpStatus': 'ON' if flags & HISTORY_PUMP_ON else 'OFF',
+        'source': 'history'
+    }
+
+
+def request_history(device_id, start, end=None, request_id=None):
+    """
+    Ask a device to stream its stored readings for a time range
+
+    Args:
+        device_id: Target device
+        start: Range start (unix seconds)
+        end: Range end (unix seconds; None for everything since)
+        request_id: Transfer ID (random if None)
+
+    Returns:
+        int: Request ID the blocks will carry
+    """
+    if request_id is None:
+        request_id = random.randint(1, 0x7fffffff)
+
+    payload = {'action': 'HISTORY', 'deviceId': device_id,
+               'requestId': request_id, 'from': start}
+    if end is not None:
+        payload['to'] = end
+
+    iot_client.publish(topic=COMMAND_TOPIC, qos=1, payload=json.dumps(payload))
+    print(f"📚 Requested history from {device_id} ({start}..{end or 'now'}), request {request_id}")
+    return request_id
+
+
+def handle_history_block(event):
+    """
+    Store one history block and acknowledge it
+
+    Args:
+        event: Block message from garden/history/<deviceId>
+
+    Returns:
+        dict: Response with the number of samples stored
+    """
+    device_id = event.get('deviceId', 'unknown')
+    seq = event.get('seq', 0)
+
+    try:
+        samples = decode_block(base64.b64decode(event.get('data', '')))
+        items = [sample_item(device_id, s) for s in samples if not s[3] & HISTORY_TIME_UPTIME]
+
+        if items:
+            with dynamodb.Table(SENSOR_DATA_TABLE).batch_writer(overwrite_by_pkeys=['deviceId', 'timestamp']) as batch:
+                for item in items:
+                    batch.put_item(Item=item)
+            if SENSOR_DATA_TABLE_V2:
+                with dynamodb.Table(SENSOR_DATA_TABLE_V2).batch_writer(overwrite_by_pkeys=['pk', 'sk']) as batch:
+                    for item in items:
+                        batch.put_item(Item=to_v2_item(item))
+
+        iot_client.publish(
+            topic=COMMAND_TOPIC,
+            qos=1,
+            payload=json.dumps({'action': 'HISTORY_ACK', 'deviceId': device_id,
+                                'requestId': event.get('requestId'), 'seq': seq})
+        )
+        print(f"📚 History block {seq} from {device_id}: {len(items)} samples"
+              f"{' (last)' if event.get('last') else ''}")
+        return {'statusCode': 200, 'body': json.dumps({'stored': len(items)})}
+
+    except Exception as e:
+        # No ack: the device resends this block after its ack timeout
+        print(f"❌ Error storing history block {seq} from {device_id}: {str(e)}")
+        return {'statusCode': 500, 'body': json.dumps({'error': str(e)})}
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        sys.exit(1)
+    # Times without an offset are taken as UTC, like stored timestamps
+    start = iso_to_epoch_ms(sys.argv[2]) // 1000
+    end = iso_to_epoch_ms(sys.argv[3]) // 1000 if len(sys.argv) > 3 else None
+    request_history(sys.argv[1], start, end)
+
+
+if __name__ == '__main__':
+    main()
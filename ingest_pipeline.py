@@ -0,0 +1,705 @@
+"""
+Smart Garden System - Sharded Ingest Pipeline
+
+Long-running ingest service for the garden/telemetry stream. Telemetry
+decoding, watering decisions and storage batching are sharded across CPU
+cores by a hash of deviceId: every device is owned by exactly one shard
+process, so device state is never shared and the hot path takes no locks.
+
+Idle shards steal raw payloads from overloaded shards, decode them and hand
+the decoded record back to the owning shard, so a few chatty devices cannot
+stall a whole core.
+
+Devices are mapped to geohash weather tiles from the coordinates they
+report. A refresher thread keeps each tile's forecast warm, spreading
+refreshes out over time, and pushes every refreshed forecast to all
+shards; shard caches are read-only, so the hot path never calls the
+weather API. Whenever a tile's forecast changes, every shard re-evaluates
+all devices in that tile with the batch decision engine and only pushes
+the commands that differ from what each device was last told.
+
+Storage is decoupled from ingest by a durable per-shard segment log (see
+segment_log.py): shards append each reading and move on, and a writer
+thread in the shard process drains the log into DynamoDB, committing its
+offset after every batch. A DynamoDB outage only grows the log, and a
+restarted shard replays whatever was not yet committed. Pump commands,
+their audit records and notifications go through a per-shard queue to a
+sender thread in the same way, so IoT, DynamoDB and SNS round trips never
+stall the shard loop.
+
+Counters, stage latency histograms and gauges are kept in shared memory
+per shard (see metrics.py) and served in the Prometheus text format on
+METRICS_PORT when run as a service.
+
+Usage (newline-delimited telemetry JSON on stdin):
+    mosquitto_sub -t garden/telemetry ... | python ingest_pipeline.py
+"""
+
+import json
+import os
+import queue
+import sys
+import threading
+import time
+import zlib
+import multiprocessing as mp
+from datetime import datetime, timezone
+
+import numpy as np
+
+from lambda_garden_automation import (
+    SENSOR_DATA_TABLE, SENSOR_DATA_TABLE_V2, CRITICAL_MOISTURE, LOCATION, dynamodb, build_sensor_item,
+    make_watering_decision, send_pump_command, log_action, send_notification,
+    publish_regional_forecast, new_trace_id
+)
+from action_log import ActionLog, ACTION_CODES, ACK_ON, ACK_OFF
+from decision_engine import evaluate_batch, reason_text
+from metrics import MetricsRegistry, METRICS_PORT
+from segment_log import SegmentLog
+from storage_keys import to_v2_item
+from telemetry_decoder import decode_telemetry
+from weather_cache import WeatherCache, device_tile
+
+# Configuration from environment variables
+NUM_SHARDS = int(os.environ.get('INGEST_SHARDS', os.cpu_count() or 1))
+STORAGE_BATCH_SIZE = int(os.environ.get('STORAGE_BATCH_SIZE', '25'))
+STORAGE_FLUSH_SECONDS = float(os.environ.get('STORAGE_FLUSH_SECONDS', '1.0'))
+INGEST_LOG_DIR = os.environ.get('INGEST_LOG_DIR', 'ingest-log')
+STORAGE_RETRY_SECONDS = 5.0
+# Queued commands and notifications per shard before apply() blocks
+COMMAND_QUEUE_SIZE = int(os.environ.get('COMMAND_QUEUE_SIZE', '1000'))
+STEAL_THRESHOLD = int(os.environ.get('STEAL_THRESHOLD', '64'))
+REFRESH_INTERVAL_SECONDS = 1.0
+REFRESH_BURST = int(os.environ.get('WEATHER_REFRESH_BURST', '10'))
+
+# Tiles ('gh:<geohash>') or city names kept warm before any device reports in
+FORECAST_LOCATIONS = [
+    location.strip()
+    for location in os.environ.get('FORECAST_LOCATIONS', LOCATION).split(',')
+    if location.strip()
+]
+
+STEAL_BATCH = 16
+IDLE_WAIT_SECONDS = 0.05
+
+# Record timestamps are the device's millis(), which restarts at zero on a
+# reboot. A step back this large is a new boot, not a reordered record.
+REBOOT_BACKSTEP_MS = int(os.environ.get('REBOOT_BACKSTEP_MS', '60000'))
+
+# Per-shard metrics, one row per shard in shared memory. Each slot has a
+# single writer: 'received' is counted by the router, the storage metrics
+# by the shard's storage writer thread, 'commands' and the command latency
+# by its command sender thread, everything else by the shard loop.
+COUNTERS = [
+    ('received', 'Payloads routed to the shard'),
+    ('decoded', 'Records applied to device state'),
+    ('stolen', 'Payloads decoded on behalf of other shards'),
+    ('decisions', 'Per-record watering decisions'),
+    ('commands', 'Pump commands published'),
+    ('stored', 'Readings written to DynamoDB'),
+    ('errors', 'Payloads that failed to decode'),
+    ('reevaluations', 'Devices re-evaluated after forecast changes'),
+    ('storage_errors', 'Failed DynamoDB batch writes'),
+    ('storage_skipped', 'Unreadable log records skipped by the storage writer'),
+]
+METRIC_NAMES = [name for name, _ in COUNTERS]
+M_RECEIVED, M_DECODED, M_STOLEN, M_DECISIONS, M_COMMANDS, M_STORED, M_ERRORS, \
+    M_REEVALUATIONS, M_STORAGE_ERRORS, M_STORAGE_SKIPPED = range(len(METRIC_NAMES))
+
+HISTOGRAMS = [
+    ('decode', 'Telemetry payload decode time'),
+    ('apply', 'Per-record handler time: state update, decision, command queueing and log append'),
+    ('decision', 'Single-device watering decision time'),
+    ('command', 'Pump command publish and audit log time'),
+    ('reevaluate', 'Batch re-evaluation time per forecast change'),
+    ('storage_batch', 'DynamoDB batch write time'),
+]
+H_DECODE, H_APPLY, H_DECISION, H_COMMAND, H_REEVALUATE, H_STORAGE_BATCH = \
+    range(len(HISTOGRAMS))
+
+SHARD_GAUGES = [
+    ('devices', 'Devices owned by the shard'),
+    ('storage_backlog_bytes', 'Segment log bytes not yet written to DynamoDB'),
+    ('weather_cache_hit_ratio', 'Forecast cache hit ratio'),
+]
+G_DEVICES, G_STORAGE_BACKLOG, G_WEATHER_HIT_RATIO = range(len(SHARD_GAUGES))
+GAUGE_INTERVAL_SECONDS = 1.0
+
+DEVICE_ID_MARKER = b'"deviceId":"'
+
+
+def shard_for(device_id, num_shards):
+    """
+    Map a device to its owning shard
+
+    Uses CRC32 rather than hash() so the mapping is stable across
+    processes and restarts.
+    """
+    return zlib.crc32(device_id.encode('utf-8')) % num_shards
+
+
+def extract_device_id(payload):
+    """
+    Cheaply pull deviceId out of a raw payload without a full decode
+
+    The firmware serializes deviceId first with no whitespace, so a byte
+    search is enough for routing; anything else falls back to json.
+    """
+    start = payload.find(DEVICE_ID_MARKER)
+    if start >= 0:
+        start += len(DEVICE_ID_MARKER)
+        end = payload.find(b'"', start)
+        if end > start:
+            return payload[start:end].decode('utf-8')
+
+    try:
+        return str(json.loads(payload).get('deviceId', 'unknown'))
+    except (ValueError, AttributeError):
+        return 'unknown'
+
+
+def is_newer_sample(state, device_time):
+    """
+    True if a record should drive device state
+
+    Stolen records can arrive after newer ones from the owner's inbox, so
+    a slightly older sample is skipped. A drop of more than
+    REBOOT_BACKSTEP_MS (far beyond any reordering from stealing) means the
+    device rebooted and its uptime clock started over; its new samples
+    are accepted from then on.
+    """
+    last = state['device_time']
+    return device_time >= last or last - device_time > REBOOT_BACKSTEP_MS
+
+
+class Shard:
+    """
+    Owns the state of every device that hashes to it
+
+    Runs in its own process. Decoded records stolen by other shards come
+    back through the handoff queue and are applied here, so device state
+    is only ever touched by its owner.
+    """
+
+    def __init__(self, shard_id, inboxes, handoffs, controls, tile_reports, registry,
+                 handoffs_pending):
+        self.shard_id = shard_id
+        self.num_shards = len(inboxes)
+        self.inbox = inboxes[shard_id]
+        self.handoff = handoffs[shard_id]
+        self.inboxes = inboxes
+        self.handoffs = handoffs
+        self.control = controls[shard_id]
+        self.tile_reports = tile_reports
+        self.metrics = registry.shard(shard_id)
+        self.last_gauges = 0
+        self.handoffs_pending = handoffs_pending
+
+        self.devices = {}
+        self.weather = WeatherCache()
+        self.known_tiles = set()
+        self.action_log = ActionLog.for_shard(shard_id)
+        self.outbox = queue.Queue(maxsize=COMMAND_QUEUE_SIZE)
+
+    def count(self, metric, amount=1):
+        self.metrics.inc(metric, amount)
+
+    def decode(self, payload):
+        start = time.perf_counter_ns()
+        record = decode_telemetry(payload)
+        self.metrics.observe_ns(H_DECODE, time.perf_counter_ns() - start)
+        return record
+
+    def update_gauges(self):
+        now = time.monotonic()
+        if now - self.last_gauges < GAUGE_INTERVAL_SECONDS:
+            return
+        self.last_gauges = now
+        self.metrics.set(G_DEVICES, len(self.devices))
+        self.metrics.set(G_STORAGE_BACKLOG, self.log.backlog())
+        lookups = self.weather.hits + self.weather.misses
+        if lookups:
+            self.metrics.set(G_WEATHER_HIT_RATIO, self.weather.hits / lookups)
+
+    def run(self, stop_event):
+        self.log = SegmentLog(os.path.join(INGEST_LOG_DIR, f'shard-{self.shard_id}'))
+        self.log_drained = threading.Event()
+        writer = threading.Thread(target=self.write_storage,
+                                  name=f'storage-writer-{self.shard_id}', daemon=True)
+        writer.start()
+        sender = threading.Thread(target=self.send_commands,
+                                  name=f'command-sender-{self.shard_id}', daemon=True)
+        sender.start()
+
+        while True:
+            did_work = self.drain_control()
+            did_work = self.drain_handoff() or did_work
+            did_work = self.drain_inbox() or did_work
+
+            if not did_work and not stop_event.is_set():
+                did_work = self.steal()
+
+            self.update_gauges()
+
+            if not did_work:
+                self.log.sync()
+                if stop_event.is_set() and self.is_drained():
+                    break
+                try:
+                    self.apply(self.decode(self.inbox.get(timeout=IDLE_WAIT_SECONDS)))
+                except queue.Empty:
+                    pass
+                except ValueError:
+                    self.count(M_ERRORS)
+
+        # Let the writer catch up with everything appended before stopping
+        self.log.sync()
+        self.log_drained.set()
+        writer.join()
+        self.outbox.put(None)
+        sender.join()
+        self.log.close()
+        self.action_log.close()
+
+    def is_drained(self):
+        return self.inbox.empty() and self.handoffs_pending[self.shard_id] == 0
+
+    def drain_control(self):
+        did_work = False
+        while True:
+            try:
+                location, forecast, changed = self.control.get_nowait()
+            except queue.Empty:
+                return did_work
+            self.weather.put(location, forecast)
+            if changed:
+                start = time.perf_counter_ns()
+                self.reevaluate(location, forecast)
+                self.metrics.observe_ns(H_REEVALUATE, time.perf_counter_ns() - start)
+            did_work = True
+
+    def drain_handoff(self):
+        did_work = False
+        while True:
+            try:
+                record = self.handoff.get_nowait()
+            except queue.Empty:
+                return did_work
+            self.apply(record)
+            with self.handoffs_pending.get_lock():
+                self.handoffs_pending[self.shard_id] -= 1
+            did_work = True
+
+    def drain_inbox(self, limit=256):
+        did_work = False
+        for _ in range(limit):
+            try:
+                payload = self.inbox.get_nowait()
+            except queue.Empty:
+                break
+            try:
+                self.apply(self.decode(payload))
+            except ValueError:
+                self.count(M_ERRORS)
+            did_work = True
+        return did_work
+
+    def steal(self):
+        """
+        Decode a batch from the most backlogged shard on its behalf
+
+        Only the stateless decode step is stolen; the decoded records are
+        handed back to the owner to apply.
+        """
+        victim, depth = None, STEAL_THRESHOLD
+        for shard_id, inbox in enumerate(self.inboxes):
+            if shard_id == self.shard_id:
+                continue
+            backlog = inbox.qsize()
+            if backlog > depth:
+                victim, depth = shard_id, backlog
+
+        if victim is None:
+            return False
+
+        # Reserve the batch before taking anything so the victim never sees
+        # an empty inbox while records are in flight to its handoff queue.
+        with self.handoffs_pending.get_lock():
+            self.handoffs_pending[victim] += STEAL_BATCH
+
+        stolen = handed_off = 0
+        for _ in range(STEAL_BATCH):
+            try:
+                payload = self.inboxes[victim].get_nowait()
+            except queue.Empty:
+                break
+            stolen += 1
+            try:
+                self.handoffs[victim].put(self.decode(payload))
+                handed_off += 1
+            except ValueError:
+                self.count(M_ERRORS)
+
+        with self.handoffs_pending.get_lock():
+            self.handoffs_pending[victim] -= STEAL_BATCH - handed_off
+        self.count(M_STOLEN, stolen)
+        return stolen > 0
+
+    def apply(self, record):
+        """Update device state, evaluate the watering decision and queue storage"""
+        start = time.perf_counter_ns()
+        self.count(M_DECODED)
+        device_id = record.get('deviceId', 'unknown')
+        moisture_percent = record.get('moisturePercent', 0)
+
+        state = self.devices.get(device_id)
+        if state is None:
+            state = self.devices[device_id] = {'device_time': -1}
+            state['location'] = tile = device_tile(record)
+            if tile not in self.known_tiles:
+                self.known_tiles.add(tile)
+                self.tile_reports.put(tile)
+
+        # Only the newest sample (since the last reboot) drives device state
+        device_time = record.get('timestamp', 0)
+        if is_newer_sample(state, device_time):
+            state['device_time'] = device_time
+            state['moisture_percent'] = moisture_percent
+            pump_status = record.get('pumpStatus', 'OFF')
+            if pump_status != state.get('pump_status', 'OFF'):
+                # Device ack: the pump actually changed state
+                self.action_log.append(
+                    device_id, ACK_ON if pump_status == 'ON' else ACK_OFF,
+                    int(time.time() * 1000), trace_id=record.get('traceId', 0)
+                )
+            state['pump_status'] = pump_status
+            state['last_seen'] = time.time()
+
+            decide_start = time.perf_counter_ns()
+            decision = make_watering_decision(moisture_percent,
+                                              self.weather.get(state['location']))
+            self.metrics.observe_ns(H_DECISION, time.perf_counter_ns() - decide_start)
+            self.count(M_DECISIONS)
+
+            if decision['should_water']:
+                self.command(device_id, state, 'WATER_ON', decision['duration'],
+                             decision['reason'], decision['reason_code'])
+
+                if moisture_percent < CRITICAL_MOISTURE:
+                    self.outbox.put((send_notification, {
+                        'subject': '🚨 CRITICAL: Garden Needs Water!',
+                        'message': f"Soil moisture critically low at {moisture_percent}% "
+                                   f"on {device_id}. Automatic watering triggered for "
+                                   f"{decision['duration']}s.",
+                        'priority': 'high'
+                    }))
+
+        # Receive time in UTC, naive like the Lambda's stamps (storage_keys
+        # reads offset-less timestamps as UTC). Blocks if the storage writer
+        # has fallen too far behind.
+        received = datetime.now(timezone.utc).replace(tzinfo=None).isoformat()
+        self.log.append(json.dumps(
+            {'record': record, 'timestamp': received}
+        ).encode('utf-8'))
+        self.metrics.observe_ns(H_APPLY, time.perf_counter_ns() - start)
+
+    def command(self, device_id, state, action, duration, reason, reason_code):
+        """Queue a pump command for one device and remember what it was told"""
+        trace_id = new_trace_id()
+        self.outbox.put((self.send_command, {
+            'device_id': device_id, 'action': action, 'duration': duration,
+            'reason': reason, 'reason_code': reason_code, 'trace_id': trace_id
+        }))
+        self.action_log.append(device_id, ACTION_CODES[action], int(time.time() * 1000),
+                               duration=duration, reason_code=reason_code, trace_id=trace_id)
+
+        state['last_action'] = action
+        state['watering_until'] = time.time() + duration if action == 'WATER_ON' else 0
+
+    def reevaluate(self, location, forecast):
+        """
+        Re-run decisions for every device in a location after a forecast change
+
+        Devices are evaluated as one batch; a command is only pushed where
+        the new decision differs from the device's current watering state.
+        """
+        device_ids = [
+            device_id for device_id, state in self.devices.items()
+            if state.get('location') == location
+        ]
+        if not device_ids:
+            return
+
+        now = time.time()
+        states = [self.devices[device_id] for device_id in device_ids]
+        moisture = np.fromiter((s['moisture_percent'] for s in states),
+                               dtype=np.float32, count=len(states))
+        watering = np.fromiter((s.get('watering_until', 0) > now for s in states),
+                               dtype=bool, count=len(states))
+        rain = np.full(len(states), forecast.get('rain_probability', 0), dtype=np.float32)
+        temperature = np.full(len(states), forecast.get('temperature', 25), dtype=np.float32)
+        hour = np.full(len(states), datetime.now().hour, dtype=np.int32)
+
+        should_water, duration, reason = evaluate_batch(moisture, rain, temperature, hour)
+        self.count(M_REEVALUATIONS, len(states))
+
+        # Deltas only: start watering that isn't running, cancel watering
+        # that no longer should be
+        for index in np.flatnonzero(should_water != watering):
+            device_id, state = device_ids[index], states[index]
+            text = reason_text(int(reason[index]), state['moisture_percent'],
+                               forecast.get('rain_probability', 0))
+            if should_water[index]:
+                self.command(device_id, state, 'WATER_ON', int(duration[index]),
+                             f'Forecast update: {text}', int(reason[index]))
+            else:
+                self.command(device_id, state, 'WATER_OFF', 0,
+                             f'Forecast update: {text}', int(reason[index]))
+
+    def send_command(self, device_id, action, duration, reason, reason_code, trace_id):
+        """Publish one pump command and write its audit record"""
+        start = time.perf_counter_ns()
+        if send_pump_command(action, duration, device_id=device_id, trace_id=trace_id):
+            self.count(M_COMMANDS)
+        log_action(device_id, action, reason, reason_code=reason_code, trace_id=trace_id)
+        self.metrics.observe_ns(H_COMMAND, time.perf_counter_ns() - start)
+
+    def send_commands(self):
+        """
+        Command sender thread: run queued commands and notifications in order
+
+        Runs until run() queues None after the shard loop has stopped, so
+        everything queued before shutdown is still sent.
+        """
+        while True:
+            job = self.outbox.get()
+            if job is None:
+                return
+            send, kwargs = job
+            try:
+                send(**kwargs)
+            except Exception as e:
+                print(f"⚠️  Shard {self.shard_id} command error: {str(e)}")
+
+    def write_storage(self):
+        """
+        Storage writer thread: drain the segment log into DynamoDB
+
+        The offset is only committed once a batch is written, so a failed
+        batch is retried and a crash replays it on restart. Runs until the
+        shard has stopped and everything appended has been written (or
+        DynamoDB fails during shutdown).
+        """
+        while True:
+            payloads, offset = self.log.read('storage', STORAGE_BATCH_SIZE,
+                                             timeout=STORAGE_FLUSH_SECONDS)
+            if not payloads:
+                if self.log_drained.is_set() and offset == self.log.head:
+                    return
+                continue
+
+            items = []
+            for payload in payloads:
+                try:
+                    entry = json.loads(payload)
+                    items.append(build_sensor_item(entry['record'], entry['timestamp']))
+                except (ValueError, KeyError, TypeError, AttributeError) as e:
+                    # Retrying can't fix it; skip it rather than stall the log
+                    self.count(M_STORAGE_SKIPPED)
+                    print(f"⚠️  Shard {self.shard_id} skipping unreadable log record: {str(e)}")
+
+            start = time.perf_counter_ns()
+            try:
+                table = dynamodb.Table(SENSOR_DATA_TABLE)
+                with table.batch_writer() as batch:
+                    for item in items:
+                        batch.put_item(Item=item)
+
+                if SENSOR_DATA_TABLE_V2:
+                    with dynamodb.Table(SENSOR_DATA_TABLE_V2).batch_writer() as batch:
+                        for item in items:
+                            batch.put_item(Item=to_v2_item(item))
+            except Exception as e:
+                self.count(M_STORAGE_ERRORS)
+                print(f"⚠️  Shard {self.shard_id} database error: {str(e)}")
+                if self.log_drained.is_set():
+                    # Shutting down: leave the rest in the log for the next run
+                    return
+                time.sleep(STORAGE_RETRY_SECONDS)
+                continue
+
+            self.metrics.observe_ns(H_STORAGE_BATCH, time.perf_counter_ns() - start)
+            self.log.commit('storage', offset)
+            self.count(M_STORED, len(items))
+
+
+def _shard_main(shard_id, inboxes, handoffs, controls, tile_reports, registry,
+                handoffs_pending, stop_event):
+    Shard(shard_id, inboxes, handoffs, controls, tile_reports, registry,
+          handoffs_pending).run(stop_event)
+
+
+class IngestPipeline:
+    """
+    Routes raw telemetry payloads to shard processes by deviceId
+
+    Args:
+        num_shards: Number of shard processes (defaults to one per core)
+        locations: Tiles/cities kept warm before devices report in
+    """
+
+    def __init__(self, num_shards=NUM_SHARDS, locations=FORECAST_LOCATIONS):
+        self.num_shards = max(1, num_shards)
+        self.locations = set(locations)
+        self.inboxes = [mp.Queue() for _ in range(self.num_shards)]
+        self.handoffs = [mp.Queue() for _ in range(self.num_shards)]
+        self.controls = [mp.Queue() for _ in range(self.num_shards)]
+        self.tile_reports = mp.Queue()
+        self.registry = MetricsRegistry(self.num_shards, COUNTERS, HISTOGRAMS, SHARD_GAUGES)
+        self.router_metrics = [self.registry.shard(i) for i in range(self.num_shards)]
+        self.handoffs_pending = mp.Array('q', self.num_shards)
+        self.stop_event = mp.Event()
+        self.processes = []
+        self.weather = WeatherCache()
+        self.refresher = None
+
+        self.registry.add_gauge('inbox_depth', 'Raw payloads waiting in each shard inbox',
+                                lambda: {i: q.qsize() for i, q in enumerate(self.inboxes)})
+        self.registry.add_gauge('handoffs_pending', 'Stolen records in flight back to their owner',
+                                lambda: dict(enumerate(self.handoffs_pending[:])))
+        self.registry.add_gauge('forecast_tiles', 'Weather tiles kept warm',
+                                lambda: len(self.locations))
+
+    def start(self):
+        for shard_id in range(self.num_shards):
+            process = mp.Process(
+                target=_shard_main,
+                args=(shard_id, self.inboxes, self.handoffs, self.controls,
+                      self.tile_reports, self.registry, self.handoffs_pending,
+                      self.stop_event),
+                name=f'ingest-shard-{shard_id}',
+                daemon=True
+            )
+            process.start()
+            self.processes.append(process)
+
+        self.refresher = threading.Thread(target=self.refresh_forecasts,
+                                          name='forecast-refresher', daemon=True)
+        self.refresher.start()
+        print(f"🚀 Ingest pipeline started with {self.num_shards} shards")
+
+    def refresh_forecasts(self):
+        """
+        Refresh stale forecasts and push them to every shard
+
+        Shards re-evaluate their devices only for changed forecasts; the
+        rest just renew the shard's cache entry.
+
+        Every refresh is also published as the region's retained forecast
+        so devices always have a recent copy.
+        """
+        while not self.stop_event.is_set():
+            # Pick up tiles first seen by the shards
+            while True:
+                try:
+                    self.locations.add(self.tile_reports.get_nowait())
+                except queue.Empty:
+                    break
+
+            # Cap refreshes per pass so new or expiring tiles can't burst
+            # the weather API
+            stale = self.weather.stale_locations(self.locations)[:REFRESH_BURST]
+            for location in stale:
+                forecast, changed = self.weather.refresh(location)
+                if forecast is None:
+                    continue  # Fetch failed; shards keep the last good forecast
+                publish_regional_forecast(location, forecast)
+                if changed:
+                    print(f"🌦️  Forecast changed for {location} - re-evaluating fleet")
+                for control in self.controls:
+                    control.put((location, forecast, changed))
+
+            self.stop_event.wait(REFRESH_INTERVAL_SECONDS)
+
+    def submit(self, payload):
+        """
+        Route one raw telemetry payload to its owning shard
+
+        Args:
+            payload: Raw JSON payload (bytes or str)
+        """
+        if isinstance(payload, str):
+            payload = payload.encode('utf-8')
+        shard_id = shard_for(extract_device_id(payload), self.num_shards)
+        self.router_metrics[shard_id].inc(M_RECEIVED)
+        self.inboxes[shard_id].put(payload)
+
+    def stop(self, timeout=30):
+        """Stop accepting work, let shards drain and flush, then join them"""
+        # Flush our feeder threads first so shards can't observe an empty
+        # inbox while submitted payloads are still in transit.
+        for inbox in self.inboxes:
+            inbox.close()
+            inbox.join_thread()
+        self.stop_event.set()
+        for process in self.processes:
+            process.join(timeout)
+        self.processes = []
+        print("🛑 Ingest pipeline stopped")
+
+    def shard_metrics(self):
+        """
+        Snapshot per-shard counters
+
+        Returns:
+            list: One dict of counters per shard
+        """
+        return self.registry.counter_snapshot()
+
+    def throughput(self, interval=1.0):
+        """
+        Measure per-shard decoded records per second over an interval
+
+        Returns:
+            list: Records/sec for each shard
+        """
+        before = self.shard_metrics()
+        time.sleep(interval)
+        after = self.shard_metrics()
+        return [
+            (a['decoded'] - b['decoded']) / interval
+            for b, a in zip(before, after)
+        ]
+
+
+def main():
+    pipeline = IngestPipeline()
+    pipeline.start()
+    if METRICS_PORT:
+        pipeline.registry.serve(METRICS_PORT)
+
+    last_report = time.monotonic()
+    last_totals = [0] * pipeline.num_shards
+    try:
+        for line in sys.stdin.buffer:
+            line = line.strip()
+            if line:
+                pipeline.submit(line)
+
+            now = time.monotonic()
+            if now - last_report >= 10:
+                totals = [m['decoded'] for m in pipeline.shard_metrics()]
+                rates = [(t - l) / (now - last_report) for t, l in zip(totals, last_totals)]
+                p99 = pipeline.registry.quantile(H_APPLY, 0.99)
+                print("📊 Shard throughput (msg/s): " +
+                      ", ".join(f"{i}={r:.0f}" for i, r in enumerate(rates)) +
+                      (f" | apply p99 {p99 * 1e6:.0f}µs" if p99 is not None else ""))
+                last_report, last_totals = now, totals
+    finally:
+        pipeline.stop()
+        for shard_id, counters in enumerate(pipeline.shard_metrics()):
+            print(f"📊 Shard {shard_id}: {counters}")
+
+
+if __name__ == '__main__':
+    main()
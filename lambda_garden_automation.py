@@ -9,9 +9,12 @@ intelligent watering decisions based on soil moisture and weather forecasts.
 import json
 import boto3
 import os
+import random
 from datetime import datetime
 from decimal import Decimal
 
+from storage_keys import to_v2_item
+
 # Initialize AWS clients
 iot_client = boto3.client('iot-data')
 dynamodb = boto3.resource('dynamodb')
@@ -19,16 +22,30 @@ sns_client = boto3.client('sns')
 
 # Configuration from environment variables
 SENSOR_DATA_TABLE = os.environ.get('SENSOR_DATA_TABLE', 'GardenSensorData')
+SENSOR_DATA_TABLE_V2 = os.environ.get('SENSOR_DATA_TABLE_V2', '')  # set to dual-write
 ACTION_LOG_TABLE = os.environ.get('ACTION_LOG_TABLE', 'GardenActionLog')
 SNS_TOPIC_ARN = os.environ.get('SNS_TOPIC_ARN', '')
 WEATHER_API_KEY = os.environ.get('WEATHER_API_KEY', '')
 LOCATION = os.environ.get('LOCATION', 'San Francisco')
 
+# Weather locations are city names, or geohash tiles marked with this
+# prefix ('gh:9q8yy') so a city like "denver" is never read as a tile
+TILE_PREFIX = 'gh:'
+
 # Moisture thresholds
 CRITICAL_MOISTURE = 15
 LOW_MOISTURE = 25
 OPTIMAL_MOISTURE = 45
 
+# Decision reason codes (low 7 bits) plus a flag bit for night watering
+REASON_ADEQUATE = 0
+REASON_CRITICAL = 1
+REASON_DRY = 2
+REASON_RAIN_EXPECTED = 3
+REASON_OPTIMAL = 4
+REASON_MANUAL = 5
+REASON_NIGHT_FLAG = 0x80
+
 
 def lambda_handler(event, context):
     """
@@ -43,6 +60,11 @@ def lambda_handler(event, context):
     """
     print(f"📥 Event received: {json.dumps(event)}")
     
+    # HISTORY backfill blocks come in through their own IoT Rule
+    if event.get('topic', '').startswith('garden/history/'):
+        from history_backfill import handle_history_block
+        return handle_history_block(event)
+    
     try:
         # Extract sensor data
         device_id = event.get('deviceId', 'unknown')
@@ -55,16 +77,20 @@ def lambda_handler(event, context):
         # Save sensor data to DynamoDB
         save_sensor_data(event)
         
-        # Get weather forecast
-        weather_data = get_weather_forecast()
+        # Get weather forecast (at the device's coordinates if it reports them)
+        weather_data = get_weather_forecast(lat=event.get('lat'), lon=event.get('lon'))
         
         # Make watering decision
         decision = make_watering_decision(moisture_percent, weather_data)
+        print(f"💡 Decision: {decision}")
         
         # Execute decision
         if decision['should_water']:
-            send_pump_command('WATER_ON', decision['duration'])
-            log_action(device_id, 'WATER_ON', decision['reason'])
+            trace_id = new_trace_id()
+            send_pump_command('WATER_ON', decision['duration'], device_id=device_id,
+                              trace_id=trace_id)
+            log_action(device_id, 'WATER_ON', decision['reason'],
+                       reason_code=decision['reason_code'], trace_id=trace_id)
             
             # Send notification for critical conditions
             if moisture_percent < CRITICAL_MOISTURE:
@@ -103,12 +129,13 @@ def make_watering_decision(moisture_percent, weather_data):
         weather_data: Weather forecast data
         
     Returns:
-        dict: Decision with should_water, duration, and reason
+        dict: Decision with should_water, duration, reason and reason_code
     """
     decision = {
         'should_water': False,
         'duration': 0,
-        'reason': 'Soil moisture adequate'
+        'reason': 'Soil moisture adequate',
+        'reason_code': REASON_ADEQUATE
     }
     
     rain_probability = weather_data.get('rain_probability', 0)
@@ -119,7 +146,8 @@ def make_watering_decision(moisture_percent, weather_data):
         decision = {
             'should_water': True,
             'duration': 30,
-            'reason': f'CRITICAL: Soil very dry ({moisture_percent}%) - immediate watering'
+            'reason': f'CRITICAL: Soil very dry ({moisture_percent}%) - immediate watering',
+            'reason_code': REASON_CRITICAL
         }
     
     # Low moisture - check weather before watering
@@ -130,31 +158,40 @@ def make_watering_decision(moisture_percent, weather_data):
             decision = {
                 'should_water': True,
                 'duration': duration,
-                'reason': f'Soil dry ({moisture_percent}%), low rain chance ({rain_probability}%)'
+                'reason': f'Soil dry ({moisture_percent}%), low rain chance ({rain_probability}%)',
+                'reason_code': REASON_DRY
             }
         else:
             decision['reason'] = f'Soil dry ({moisture_percent}%) but rain expected ({rain_probability}%)'
+            decision['reason_code'] = REASON_RAIN_EXPECTED
     
     # Optimal moisture - no watering needed
     elif moisture_percent >= OPTIMAL_MOISTURE:
         decision['reason'] = f'Soil moisture optimal ({moisture_percent}%)'
+        decision['reason_code'] = REASON_OPTIMAL
     
     # Adjust duration based on time of day (night watering is more efficient)
     current_hour = datetime.now().hour
     if decision['should_water'] and (current_hour < 6 or current_hour > 20):
         decision['duration'] += 5
         decision['reason'] += ' - Night watering (optimal time)'
+        decision['reason_code'] |= REASON_NIGHT_FLAG
     
-    print(f"💡 Decision: {decision}")
     return decision
 
 
-def get_weather_forecast():
+def get_weather_forecast(location=None, lat=None, lon=None):
     """
     Fetch weather data from OpenWeatherMap API
     
+    Args:
+        location: City name (defaults to LOCATION)
+        lat: Latitude, used with lon instead of the city name
+        lon: Longitude
+        
     Returns:
         dict: Weather data with temperature, humidity, rain probability
+              (defaults with 'fallback': True if no forecast could be fetched)
     """
     if not WEATHER_API_KEY:
         print("⚠️  No weather API key configured")
@@ -162,7 +199,8 @@ def get_weather_forecast():
             'temperature': 25,
             'humidity': 50,
             'rain_probability': 0,
-            'description': 'unavailable'
+            'description': 'unavailable',
+            'fallback': True
         }
     
     try:
@@ -170,10 +208,14 @@ def get_weather_forecast():
         
         url = f"http://api.openweathermap.org/data/2.5/weather"
         params = {
-            'q': LOCATION,
             'appid': WEATHER_API_KEY,
             'units': 'metric'
         }
+        if lat is not None and lon is not None:
+            params['lat'] = round(lat, 3)
+            params['lon'] = round(lon, 3)
+        else:
+            params['q'] = location or LOCATION
         
         response = requests.get(url, params=params, timeout=5)
         data = response.json()
@@ -196,17 +238,31 @@ def get_weather_forecast():
             'temperature': 25,
             'humidity': 50,
             'rain_probability': 0,
-            'description': 'error fetching data'
+            'description': 'error fetching data',
+            'fallback': True
         }
 
 
-def send_pump_command(action, duration=10):
+def new_trace_id():
+    """Random 63-bit ID linking a command to its log entry and device ack"""
+    return random.getrandbits(63)
+
+
+def send_pump_command(action, duration=10, device_id=None, trace_id=None, at=None, schedule_id=None,
+                      zones=None, dose_ml=None):
     """
     Send command to IoT device to control pump
     
     Args:
-        action: 'WATER_ON' or 'WATER_OFF'
+        action: 'WATER_ON', 'WATER_OFF' or 'CANCEL' (drops scheduled commands)
         duration: Duration in seconds (for WATER_ON)
+        device_id: Target device (omit to address every device)
+        trace_id: Echoed back by the device in its next telemetry
+        at: Run time (datetime or unix seconds); the device keeps the command
+            in its schedule and runs it then, even if offline by that time
+        schedule_id: Identifies a scheduled command for a later CANCEL
+        zones: Zone numbers (1-based) on the device's relay bank; omit for the pump
+        dose_ml: Nutrient dose to inject while watering (WATER_ON)
         
     Returns:
         bool: True if successful
@@ -218,6 +274,18 @@ def send_pump_command(action, duration=10):
         'duration': duration,
         'timestamp': datetime.now().isoformat()
     }
+    if device_id:
+        payload['deviceId'] = device_id
+    if trace_id is not None:
+        payload['traceId'] = trace_id
+    if at is not None:
+        payload['at'] = int(at.timestamp()) if isinstance(at, datetime) else int(at)
+    if schedule_id is not None:
+        payload['scheduleId'] = schedule_id
+    if zones:
+        payload['zones'] = list(zones)
+    if dose_ml:
+        payload['doseMl'] = dose_ml
     
     try:
         response = iot_client.publish(
@@ -225,7 +293,8 @@ def send_pump_command(action, duration=10):
             qos=1,
             payload=json.dumps(payload)
         )
-        print(f"✅ Command sent: {action} for {duration}s")
+        when = f" at {payload['at']}" if at is not None else ''
+        print(f"✅ Command sent: {action} for {duration}s{when}")
         return True
         
     except Exception as e:
@@ -233,6 +302,59 @@ def send_pump_command(action, duration=10):
         return False
 
 
+def forecast_topic(region):
+    """
+    MQTT topic carrying the retained forecast for a region
+    
+    Args:
+        region: Region name (e.g. 'San Francisco') or tile ('gh:9q8yy')
+        
+    Returns:
+        str: Topic such as 'garden/forecast/san-francisco' or
+            'garden/forecast/tile/9q8yy'
+    """
+    if region.startswith(TILE_PREFIX):
+        return 'garden/forecast/tile/' + region[len(TILE_PREFIX):]
+    return 'garden/forecast/' + '-'.join(region.lower().split())
+
+
+def publish_regional_forecast(region, weather_data):
+    """
+    Publish a compact retained forecast for every device in a region
+    
+    Devices subscribe to their region's topic and get the latest forecast
+    from the broker on connect, so weather costs one message per region
+    rather than one API call per telemetry message.
+    
+    Args:
+        region: Region name
+        weather_data: Weather forecast data
+        
+    Returns:
+        bool: True if successful
+    """
+    payload = {
+        't': weather_data.get('temperature', 25),
+        'h': weather_data.get('humidity', 50),
+        'r': round(weather_data.get('rain_probability', 0)),
+        'ts': int(datetime.now().timestamp())
+    }
+    
+    try:
+        iot_client.publish(
+            topic=forecast_topic(region),
+            qos=1,
+            retain=True,
+            payload=json.dumps(payload, separators=(',', ':'))
+        )
+        print(f"📡 Forecast published for {region}")
+        return True
+        
+    except Exception as e:
+        print(f"❌ Error publishing forecast: {str(e)}")
+        return False
+
+
 def save_sensor_data(data):
     """
     Save sensor readings to DynamoDB
@@ -241,26 +363,49 @@ def save_sensor_data(data):
         data: Sensor data dict
     """
     try:
+        item = build_sensor_item(data)
+        
         table = dynamodb.Table(SENSOR_DATA_TABLE)
+        table.put_item(Item=item)
         
-        # Convert float to Decimal for DynamoDB
-        item = {
-            'deviceId': data.get('deviceId', 'unknown'),
-            'timestamp': datetime.now().isoformat(),
-            'soilMoisture': Decimal(str(data.get('soilMoisture', 0))),
-            'moisturePercent': Decimal(str(data.get('moisturePercent', 0))),
-            'pumpStatus': data.get('pumpStatus', 'OFF'),
-            'rssi': Decimal(str(data.get('rssi', 0))) if 'rssi' in data else None
-        }
+        # Binary device+day keyed table (see storage_keys.py)
+        if SENSOR_DATA_TABLE_V2:
+            dynamodb.Table(SENSOR_DATA_TABLE_V2).put_item(Item=to_v2_item(item))
         
-        table.put_item(Item=item)
         print(f"💾 Data saved to DynamoDB")
         
     except Exception as e:
         print(f"⚠️  Database error: {str(e)}")
 
 
-def log_action(device_id, action, reason):
+def build_sensor_item(data, timestamp=None):
+    """
+    Build the DynamoDB item for a sensor reading
+    
+    Args:
+        data: Sensor data dict
+        timestamp: ISO receive time (defaults to now)
+        
+    Returns:
+        dict: Item ready for put_item / batch_writer
+    """
+    # Convert float to Decimal for DynamoDB
+    return {
+        'deviceId': data.get('deviceId', 'unknown'),
+        'timestamp': timestamp or datetime.now().isoformat(),
+        'soilMoisture': Decimal(str(data.get('soilMoisture', 0))),
+        'moisturePercent': Decimal(str(data.get('moisturePercent', 0))),
+        'pumpStatus': data.get('pumpStatus', 'OFF'),
+        'rssi': Decimal(str(data.get('rssi', 0))) if 'rssi' in data else None,
+        # Calibrated sensor voltage (soilMoisture stays raw ADC counts)
+        'soilMv': Decimal(str(data['soilMv'])) if 'soilMv' in data else None,
+        'soilTemp': Decimal(str(data['soilTemp'])) if 'soilTemp' in data else None,
+        # SAMPLE_* bits from the firmware: 1 pump on, 2 dosing, 4 no quiet window, 8 noisy burst
+        'sampleFlags': Decimal(str(data['sampleFlags'])) if 'sampleFlags' in data else None
+    }
+
+
+def log_action(device_id, action, reason, reason_code=None, trace_id=None):
     """
     Log watering actions for audit trail
     
@@ -268,6 +413,8 @@ def log_action(device_id, action, reason):
         device_id: Device identifier
         action: Action taken (e.g., 'WATER_ON')
         reason: Reason for the action
+        reason_code: Machine-readable reason (REASON_* constant)
+        trace_id: Trace ID sent with the command
     """
     try:
         table = dynamodb.Table(ACTION_LOG_TABLE)
@@ -278,6 +425,10 @@ def log_action(device_id, action, reason):
             'action': action,
             'reason': reason
         }
+        if reason_code is not None:
+            item['reasonCode'] = reason_code
+        if trace_id is not None:
+            item['traceId'] = trace_id
         
         table.put_item(Item=item)
         print(f"📝 Action logged: {action}")
@@ -0,0 +1,275 @@
+"""
+Smart Garden System - Metrics Registry
+
+Low-overhead metrics for the multi-process ingest service, exposed in the
+Prometheus text format on /metrics.
+
+All values live in shared memory with one row per shard (one shard per
+core). Every slot has a single writer thread, so recording is a plain
+array update with no locks or IPC; the scrape in the parent process reads
+the rows as they are.
+
+- Counters: monotonically increasing, per shard
+- Histograms: HDR-style log-linear buckets over microseconds (about 3%
+  relative error up to ~71 minutes). Rendered as Prometheus histograms on
+  a fixed set of `le` bounds, with exact-bucket quantiles for local reports
+- Gauges: per-shard slots set by the shard, or callables evaluated at
+  scrape time in the parent (queue depths and the like)
+
+Usage:
+    registry = MetricsRegistry(num_shards, counters, histograms, gauges)
+    shard = registry.shard(shard_id)          # in the shard process
+    shard.inc(DECODED)
+    shard.observe_ns(DECODE, time.perf_counter_ns() - start)
+    registry.serve(9108)                      # in the parent
+"""
+
+import multiprocessing as mp
+import os
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+METRICS_PORT = int(os.environ.get('METRICS_PORT', '9108'))
+
+# HDR layout: values below 2 * HALF get one bucket each; above that every
+# power of two is split into HALF buckets.
+MANTISSA_BITS = 6
+HALF = 1 << (MANTISSA_BITS - 1)
+MAX_VALUE_US = 2**32 - 1
+
+
+def bucket_index(value):
+    """HDR bucket for a value in microseconds"""
+    if value < 2 * HALF:
+        return max(value, 0)
+    value = min(value, MAX_VALUE_US)
+    exponent = value.bit_length() - MANTISSA_BITS
+    return exponent * HALF + (value >> exponent)
+
+
+def bucket_bounds(index):
+    """(lower, upper) microseconds covered by an HDR bucket"""
+    if index < 2 * HALF:
+        return index, index + 1
+    exponent = index // HALF - 1
+    mantissa = index % HALF + HALF
+    return mantissa << exponent, (mantissa + 1) << exponent
+
+
+HDR_BUCKETS = bucket_index(MAX_VALUE_US) + 1
+# Per histogram row: buckets, then count and sum (µs)
+HIST_WIDTH = HDR_BUCKETS + 2
+
+# Exposed `le` bounds (seconds)
+LE_BOUNDS = (0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01,
+             0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0)
+
+
+class ShardMetrics:
+    """Writer view of one shard's row; only ever used by that shard"""
+
+    def __init__(self, registry, shard_id):
+        self.counters = registry.counters
+        self.histograms = registry.histograms
+        self.gauges = registry.gauges
+        self.counter_row = shard_id * len(registry.counter_defs)
+        self.histogram_row = shard_id * len(registry.histogram_defs)
+        self.gauge_row = shard_id * len(registry.gauge_defs)
+
+    def inc(self, counter, amount=1):
+        self.counters[self.counter_row + counter] += amount
+
+    def observe_ns(self, histogram, elapsed_ns):
+        """Record a duration measured with time.perf_counter_ns()"""
+        value = elapsed_ns // 1000
+        base = (self.histogram_row + histogram) * HIST_WIDTH
+        self.histograms[base + bucket_index(value)] += 1
+        self.histograms[base + HDR_BUCKETS] += 1
+        self.histograms[base + HDR_BUCKETS + 1] += value
+
+    def set(self, gauge, value):
+        self.gauges[self.gauge_row + gauge] = value
+
+
+class MetricsRegistry:
+    """
+    Shared-memory metrics for a fixed number of shards
+
+    Create before starting the shard processes and pass it to them. Scrape
+    gauges (add_gauge) stay in the creating process.
+
+    Args:
+        num_shards: Number of shard rows
+        counters: (name, help) per counter
+        histograms: (name, help) per latency histogram
+        gauges: (name, help) per per-shard gauge
+        namespace: Prefix for every exposed metric name
+    """
+
+    def __init__(self, num_shards, counters, histograms=(), gauges=(),
+                 namespace='garden_ingest'):
+        self.num_shards = num_shards
+        self.counter_defs = list(counters)
+        self.histogram_defs = list(histograms)
+        self.gauge_defs = list(gauges)
+        self.namespace = namespace
+        self.scrape_gauges = []
+
+        self.counters = mp.Array('Q', num_shards * len(self.counter_defs), lock=False)
+        self.histograms = mp.Array('Q', num_shards * len(self.histogram_defs) * HIST_WIDTH,
+                                   lock=False)
+        self.gauges = mp.Array('d', max(1, num_shards * len(self.gauge_defs)), lock=False)
+
+    def __getstate__(self):
+        # Scrape gauges are parent-only callables (closures over queues and
+        # the like) and can't be pickled; shard processes never render, so
+        # they only get the shared arrays
+        state = self.__dict__.copy()
+        state['scrape_gauges'] = []
+        return state
+
+    def shard(self, shard_id):
+        return ShardMetrics(self, shard_id)
+
+    def add_gauge(self, name, help_text, read):
+        """
+        Register a gauge evaluated at scrape time
+
+        Args:
+            name: Metric name (without namespace)
+            help_text: HELP text
+            read: Callable returning a number, or a {shard_id: number} dict
+        """
+        self.scrape_gauges.append((name, help_text, read))
+
+    def counter_snapshot(self):
+        """
+        Returns:
+            list: One {counter name: value} dict per shard
+        """
+        snapshot = list(self.counters)
+        width = len(self.counter_defs)
+        names = [name for name, _ in self.counter_defs]
+        return [
+            dict(zip(names, snapshot[shard_id * width:(shard_id + 1) * width]))
+            for shard_id in range(self.num_shards)
+        ]
+
+    def histogram_buckets(self, histogram, shard_id=None):
+        """
+        Bucket counts, count and sum (µs) for one shard or merged over all
+
+        Returns:
+            tuple: (bucket count list, total count, sum in µs)
+        """
+        shards = range(self.num_shards) if shard_id is None else [shard_id]
+        merged = [0] * HIST_WIDTH
+        for shard in shards:
+            base = (shard * len(self.histogram_defs) + histogram) * HIST_WIDTH
+            for index, value in enumerate(self.histograms[base:base + HIST_WIDTH]):
+                merged[index] += value
+        return merged[:HDR_BUCKETS], merged[HDR_BUCKETS], merged[HDR_BUCKETS + 1]
+
+    def quantile(self, histogram, q, shard_id=None):
+        """
+        Latency quantile in seconds (bucket midpoint), or None if empty
+
+        Args:
+            histogram: Histogram index
+            q: Quantile, 0..1
+            shard_id: Shard, or None for all shards
+        """
+        buckets, count, _ = self.histogram_buckets(histogram, shard_id)
+        if not count:
+            return None
+        target = max(1, q * count)
+        seen = 0
+        for index, value in enumerate(buckets):
+            seen += value
+            if seen >= target:
+                lower, upper = bucket_bounds(index)
+                return (lower + upper) / 2 / 1e6
+        return MAX_VALUE_US / 1e6
+
+    def render(self):
+        """Everything in the Prometheus text exposition format"""
+        lines = []
+        ns = self.namespace
+
+        counters = self.counter_snapshot()
+        for name, help_text in self.counter_defs:
+            lines.append(f'# HELP {ns}_{name}_total {help_text}')
+            lines.append(f'# TYPE {ns}_{name}_total counter')
+            for shard_id, values in enumerate(counters):
+                lines.append(f'{ns}_{name}_total{{shard="{shard_id}"}} {values[name]}')
+
+        for histogram, (name, help_text) in enumerate(self.histogram_defs):
+            metric = f'{ns}_{name}_seconds'
+            lines.append(f'# HELP {metric} {help_text}')
+            lines.append(f'# TYPE {metric} histogram')
+            for shard_id in range(self.num_shards):
+                buckets, count, total_us = self.histogram_buckets(histogram, shard_id)
+                cumulative = 0
+                index = 0
+                for le in LE_BOUNDS:
+                    limit_us = le * 1e6
+                    while index < HDR_BUCKETS and bucket_bounds(index)[1] <= limit_us:
+                        cumulative += buckets[index]
+                        index += 1
+                    lines.append(f'{metric}_bucket{{shard="{shard_id}",le="{le}"}} {cumulative}')
+                lines.append(f'{metric}_bucket{{shard="{shard_id}",le="+Inf"}} {count}')
+                lines.append(f'{metric}_sum{{shard="{shard_id}"}} {total_us / 1e6}')
+                lines.append(f'{metric}_count{{shard="{shard_id}"}} {count}')
+
+        width = len(self.gauge_defs)
+        for gauge, (name, help_text) in enumerate(self.gauge_defs):
+            lines.append(f'# HELP {ns}_{name} {help_text}')
+            lines.append(f'# TYPE {ns}_{name} gauge')
+            for shard_id in range(self.num_shards):
+                lines.append(f'{ns}_{name}{{shard="{shard_id}"}} '
+                             f'{self.gauges[shard_id * width + gauge]}')
+
+        for name, help_text, read in self.scrape_gauges:
+            lines.append(f'# HELP {ns}_{name} {help_text}')
+            lines.append(f'# TYPE {ns}_{name} gauge')
+            try:
+                value = read()
+            except Exception as e:
+                print(f"⚠️  Gauge {name} failed: {str(e)}")
+                continue
+            if isinstance(value, dict):
+                for shard_id, shard_value in value.items():
+                    lines.append(f'{ns}_{name}{{shard="{shard_id}"}} {shard_value}')
+            else:
+                lines.append(f'{ns}_{name} {value}')
+
+        return '\n'.join(lines) + '\n'
+
+    def serve(self, port=METRICS_PORT, host='0.0.0.0'):
+        """
+        Serve /metrics from a background thread
+
+        Returns:
+            ThreadingHTTPServer: Call shutdown() to stop it
+        """
+        registry = self
+
+        class Handler(BaseHTTPRequestHandler):
+            def do_GET(self):
+                if self.path.split('?')[0] != '/metrics':
+                    self.send_error(404)
+                    return
+                body = registry.render().encode('utf-8')
+                self.send_response(200)
+                self.send_header('Content-Type', 'text/plain; version=0.0.4; charset=utf-8')
+                self.send_header('Content-Length', str(len(body)))
+                self.end_headers()
+                self.wfile.write(body)
+
+            def log_message(self, format, *args):
+                pass
+
+        server = ThreadingHTTPServer((host, port), Handler)
+        threading.Thread(target=server.serve_forever, name='metrics-http', daemon=True).start()
+        print(f"📈 Metrics on http://{host}:{port}/metrics")
+        return server
@@ -0,0 +1,124 @@
+"""
+Smart Garden System - Sensor Key Migration
+
+Backfills GardenSensorDataV2 (binary device+day / millisecond keys, see
+storage_keys.py) from the original GardenSensorData table. The source is
+read with a parallel segmented scan. Each scanned page is written through
+a batch writer and flushed before its position is saved. Progress is
+checkpointed per segment, so an interrupted run resumes where it stopped;
+rewrites are idempotent because the V2 keys are derived from the source
+keys.
+
+Usage:
+    python migrate_sensor_keys.py [--segments 16] [--checkpoint migrate.json]
+"""
+
+import argparse
+import json
+import os
+import threading
+import time
+import boto3
+from concurrent.futures import ThreadPoolExecutor
+
+from storage_keys import to_v2_item
+
+SOURCE_TABLE = os.environ.get('SENSOR_DATA_TABLE', 'GardenSensorData')
+DEST_TABLE = os.environ.get('SENSOR_DATA_TABLE_V2', 'GardenSensorDataV2')
+
+DONE = 'done'
+
+
+class Checkpoint:
+    """Per-segment LastEvaluatedKey, saved to a local JSON file"""
+
+    def __init__(self, path, segments):
+        self.path = path
+        self.lock = threading.Lock()
+        self.state = {'segments': segments, 'positions': {}}
+
+        if os.path.exists(path):
+            with open(path) as f:
+                saved = json.load(f)
+            if saved.get('segments') == segments:
+                self.state = saved
+            else:
+                print(f"⚠️  Checkpoint was for {saved.get('segments')} segments - starting over")
+
+    def position(self, segment):
+        return self.state['positions'].get(str(segment))
+
+    def save(self, segment, position):
+        with self.lock:
+            self.state['positions'][str(segment)] = position
+            tmp = self.path + '.tmp'
+            with open(tmp, 'w') as f:
+                json.dump(self.state, f)
+            os.replace(tmp, self.path)
+
+
+def migrate_segment(segment, segments, checkpoint, counts):
+    position = checkpoint.position(segment)
+    if position == DONE:
+        return
+
+    # Each segment runs on its own thread, and boto3 resources are not
+    # thread-safe, so every worker builds its tables from its own session
+    dynamodb = boto3.session.Session().resource('dynamodb')
+    source = dynamodb.Table(SOURCE_TABLE)
+    dest = dynamodb.Table(DEST_TABLE)
+
+    kwargs = {'Segment': segment, 'TotalSegments': segments}
+    if position:
+        kwargs['ExclusiveStartKey'] = position
+
+    while True:
+        response = source.scan(**kwargs)
+        items = response.get('Items', [])
+        # One writer per page: leaving the block flushes it, so the
+        # checkpoint never moves past items still buffered in the writer
+        with dest.batch_writer() as batch:
+            for item in items:
+                batch.put_item(Item=to_v2_item(item))
+
+        with checkpoint.lock:
+            counts[segment] += len(items)
+
+        last_key = response.get('LastEvaluatedKey')
+        if not last_key:
+            break
+        kwargs['ExclusiveStartKey'] = last_key
+        checkpoint.save(segment, last_key)
+
+    checkpoint.save(segment, DONE)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Backfill GardenSensorDataV2')
+    parser.add_argument('--segments', type=int, default=16)
+    parser.add_argument('--checkpoint', default='migrate_sensor_keys.json')
+    args = parser.parse_args()
+
+    checkpoint = Checkpoint(args.checkpoint, args.segments)
+    counts = [0] * args.segments
+
+    print(f"🚚 Migrating {SOURCE_TABLE} -> {DEST_TABLE} with {args.segments} segments")
+    start = time.monotonic()
+
+    with ThreadPoolExecutor(max_workers=args.segments) as pool:
+        futures = [
+            pool.submit(migrate_segment, segment, args.segments, checkpoint, counts)
+            for segment in range(args.segments)
+        ]
+        while not all(f.done() for f in futures):
+            time.sleep(10)
+            total = sum(counts)
+            print(f"   {total:,} items ({total / (time.monotonic() - start):,.0f}/s)")
+        for f in futures:
+            f.result()
+
+    print(f"✅ Migrated {sum(counts):,} items in {time.monotonic() - start:.0f}s")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,256 @@
+"""
+Smart Garden System - Retention Compactor
+
+Hot/cold retention for GardenSensorData. Raw 60-second samples are kept
+for RAW_RETENTION_DAYS; older days are compacted into 5-minute and hourly
+rollups in S3 (infrequent-access storage) and the raw items are deleted.
+The dual-written GardenSensorDataV2 copies expire by TTL over the same
+window (see storage_keys.py), so the rollups built here cover them too.
+
+Runs daily from EventBridge as a background job. Devices are compacted in
+parallel, and every read and delete goes through a shared token bucket so
+the job never takes enough table capacity to slow ingest down.
+"""
+
+import json
+import os
+import threading
+import time
+import boto3
+from concurrent.futures import ThreadPoolExecutor
+from datetime import datetime, timedelta
+from boto3.dynamodb.conditions import Attr, Key
+
+s3_client = boto3.client('s3')
+
+TABLE_NAME = os.environ.get('SENSOR_DATA_TABLE', 'GardenSensorData')
+BUCKET_NAME = os.environ.get('ROLLUP_BUCKET', 'garden-data-analytics')
+RAW_RETENTION_DAYS = int(os.environ.get('RAW_RETENTION_DAYS', '30'))
+COMPACTION_WORKERS = int(os.environ.get('COMPACTION_WORKERS', '4'))
+MAX_ITEMS_PER_SECOND = float(os.environ.get('COMPACTION_MAX_ITEMS_PER_SEC', '200'))
+COLD_STORAGE_CLASS = 'STANDARD_IA'
+
+# Rollup resolutions: name -> bucket width in seconds
+ROLLUPS = {'5m': 300, '1h': 3600}
+
+# boto3 resources are not thread-safe, so each worker gets its own
+_worker = threading.local()
+
+
+def worker_table():
+    """This thread's GardenSensorData Table, from its own boto3 session"""
+    table = getattr(_worker, 'table', None)
+    if table is None:
+        table = boto3.session.Session().resource('dynamodb').Table(TABLE_NAME)
+        _worker.table = table
+    return table
+
+
+def lambda_handler(event, context):
+    """
+    Compact every day older than the retention window
+
+    Event (optional):
+        deviceIds: Only compact these devices
+        retentionDays: Override RAW_RETENTION_DAYS
+    """
+    retention_days = int(event.get('retentionDays', RAW_RETENTION_DAYS))
+    cutoff = (datetime.now() - timedelta(days=retention_days)).strftime('%Y-%m-%d')
+
+    throttle = TokenBucket(MAX_ITEMS_PER_SECOND)
+
+    device_ids = event.get('deviceIds') or find_devices_before(cutoff, throttle)
+    print(f"🗜️  Compacting {len(device_ids)} devices before {cutoff}")
+
+    with ThreadPoolExecutor(max_workers=COMPACTION_WORKERS) as pool:
+        results = list(pool.map(
+            lambda device_id: compact_device(device_id, cutoff, throttle),
+            device_ids
+        ))
+
+    summary = {
+        'cutoff': cutoff,
+        'devices': len(device_ids),
+        'days_compacted': sum(r['days'] for r in results),
+        'raw_items_deleted': sum(r['deleted'] for r in results)
+    }
+    print(f"✅ Compaction finished: {summary}")
+    return {'statusCode': 200, 'body': json.dumps(summary)}
+
+
+class TokenBucket:
+    """
+    Thread-safe rate limiter shared by all compaction workers
+
+    Args:
+        rate: Items per second
+        burst: Maximum tokens saved up (defaults to one second's worth)
+    """
+
+    def __init__(self, rate, burst=None):
+        self.rate = rate
+        self.capacity = burst or rate
+        self.tokens = self.capacity
+        self.updated = time.monotonic()
+        self.lock = threading.Lock()
+
+    def acquire(self, count=1):
+        """Block until `count` items may proceed"""
+        while True:
+            with self.lock:
+                now = time.monotonic()
+                self.tokens = min(self.capacity, self.tokens + (now - self.updated) * self.rate)
+                self.updated = now
+                if self.tokens >= count or self.tokens >= self.capacity:
+                    self.tokens -= count
+                    return
+                wait = (count - self.tokens) / self.rate
+            time.sleep(wait)
+
+
+def find_devices_before(cutoff, throttle, segments=COMPACTION_WORKERS):
+    """Distinct deviceIds that still have raw items older than the cutoff"""
+
+    def scan_segment(segment):
+        table = worker_table()
+        found = set()
+        kwargs = {
+            'Segment': segment,
+            'TotalSegments': segments,
+            'ProjectionExpression': 'deviceId',
+            'FilterExpression': Attr('timestamp').lt(cutoff)
+        }
+        while True:
+            response = table.scan(**kwargs)
+            throttle.acquire(max(1, response.get('ScannedCount', 1)))
+            found.update(item['deviceId'] for item in response.get('Items', []))
+            if 'LastEvaluatedKey' not in response:
+                return found
+            kwargs['ExclusiveStartKey'] = response['LastEvaluatedKey']
+
+    with ThreadPoolExecutor(max_workers=segments) as pool:
+        return sorted(set().union(*pool.map(scan_segment, range(segments))))
+
+
+def compact_device(device_id, cutoff, throttle):
+    """
+    Roll up and delete one device's raw items older than the cutoff
+
+    Items are processed a day at a time in timestamp order. A day's rollups
+    are written before its raw items are deleted; if they already exist the
+    day was compacted by an earlier, interrupted run and only the delete is
+    repeated, so rollups are never rebuilt from a partial day.
+    """
+    table = worker_table()
+    result = {'days': 0, 'deleted': 0}
+    day, day_items = None, []
+
+    kwargs = {'KeyConditionExpression': Key('deviceId').eq(device_id) & Key('timestamp').lt(cutoff)}
+    while True:
+        response = table.query(**kwargs)
+        items = response.get('Items', [])
+        throttle.acquire(max(1, len(items)))
+
+        for item in items:
+            item_day = item['timestamp'][:10]
+            if item_day != day:
+                if day_items:
+                    finish_day(table, device_id, day, day_items, throttle, result)
+                day, day_items = item_day, []
+            day_items.append(item)
+
+        if 'LastEvaluatedKey' not in response:
+            break
+        kwargs['ExclusiveStartKey'] = response['LastEvaluatedKey']
+
+    if day_items:
+        finish_day(table, device_id, day, day_items, throttle, result)
+    return result
+
+
+def finish_day(table, device_id, day, items, throttle, result):
+    if not rollups_exist(device_id, day):
+        for name, width in ROLLUPS.items():
+            write_rollup(device_id, day, name, build_rollup(items, width))
+        result['days'] += 1
+
+    with table.batch_writer() as batch:
+        for item in items:
+            throttle.acquire()
+            batch.delete_item(Key={'deviceId': item['deviceId'], 'timestamp': item['timestamp']})
+    result['deleted'] += len(items)
+
+
+def build_rollup(items, width):
+    """
+    Aggregate raw items into fixed-width time buckets
+
+    Args:
+        items: Raw items for one device and day, in timestamp order
+        width: Bucket width in seconds
+
+    Returns:
+        list: One dict per non-empty bucket
+    """
+    buckets = {}
+    for item in items:
+        ts = datetime.fromisoformat(item['timestamp']).timestamp()
+        start = int(ts // width * width)
+        moisture = float(item.get('moisturePercent', 0))
+        raw = float(item.get('soilMoisture', 0))
+
+        bucket = buckets.get(start)
+        if bucket is None:
+            bucket = buckets[start] = {
+                'bucketStart': datetime.fromtimestamp(start).isoformat(),
+                'count': 0, 'moistureSum': 0.0, 'rawSum': 0.0,
+                'moistureMin': moisture, 'moistureMax': moisture,
+                'pumpOnSamples': 0
+            }
+        bucket['count'] += 1
+        bucket['moistureSum'] += moisture
+        bucket['rawSum'] += raw
+        bucket['moistureMin'] = min(bucket['moistureMin'], moisture)
+        bucket['moistureMax'] = max(bucket['moistureMax'], moisture)
+        if item.get('pumpStatus') == 'ON':
+            bucket['pumpOnSamples'] += 1
+
+    rollup = []
+    for start in sorted(buckets):
+        bucket = buckets[start]
+        count = bucket.pop('count')
+        rollup.append({
+            'bucketStart': bucket['bucketStart'],
+            'samples': count,
+            'moistureAvg': round(bucket['moistureSum'] / count, 2),
+            'moistureMin': bucket['moistureMin'],
+            'moistureMax': bucket['moistureMax'],
+            'soilMoistureAvg': round(bucket['rawSum'] / count, 1),
+            'pumpOnSamples': bucket['pumpOnSamples']
+        })
+    return rollup
+
+
+def rollup_key(device_id, day, name):
+    return f"garden-rollups/{name}/{day[:4]}/{day[5:7]}/{day}/{device_id}.jsonl"
+
+
+def rollups_exist(device_id, day):
+    # The hourly rollup is written last, so it marks a complete day
+    try:
+        s3_client.head_object(Bucket=BUCKET_NAME, Key=rollup_key(device_id, day, '1h'))
+        return True
+    except s3_client.exceptions.ClientError as e:
+        if e.response['Error']['Code'] in ('404', 'NoSuchKey', 'NotFound'):
+            return False
+        raise
+
+
+def write_rollup(device_id, day, name, rollup):
+    s3_client.put_object(
+        Bucket=BUCKET_NAME,
+        Key=rollup_key(device_id, day, name),
+        Body='\n'.join(json.dumps(row) for row in rollup) + '\n',
+        ContentType='application/x-ndjson',
+        StorageClass=COLD_STORAGE_CLASS
+    )
@@ -0,0 +1,179 @@
+/*
+ * Smart Garden System - Asynchronous Serial Log
+ *
+ * Serial.println() at 115200 baud blocks once the UART FIFO is full, which
+ * stalls sampling and MQTT for milliseconds per line. Runtime logging goes
+ * through this ring buffer instead: logLine()/logPrintf() only copy into
+ * RAM, and a low-priority FreeRTOS task on the other core writes it out to
+ * the UART at whatever rate the port can take.
+ *
+ * When the ring is full, whole lines are dropped rather than blocking the
+ * caller; the drain task reports how many were lost once there is room.
+ *
+ * Call serialLogBegin() once after Serial.begin().
+ */
+
+#ifndef SERIAL_LOG_H
+#define SERIAL_LOG_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+#ifndef SERIAL_LOG_BYTES
+#define SERIAL_LOG_BYTES 8192
+#endif
+
+#define SERIAL_LOG_TASK_PRIORITY 1   // Just above idle
+#define SERIAL_LOG_TASK_CORE 0       // Arduino loop() runs on core 1
+#define SERIAL_LOG_CHUNK 128
+
+struct SerialLogStats {
+  uint32_t lines;          // Lines accepted
+  uint32_t droppedLines;   // Lines dropped because the ring was full
+  uint32_t droppedBytes;
+  uint32_t highWater;      // Most bytes ever waiting in the ring
+};
+
+static char serialLogRing[SERIAL_LOG_BYTES];
+static volatile uint32_t serialLogHead = 0;   // Total bytes ever written
+static volatile uint32_t serialLogTail = 0;   // Total bytes ever drained
+static uint32_t serialLogReported = 0;        // droppedLines already reported
+static SerialLogStats serialLogStats = {0, 0, 0, 0};
+static portMUX_TYPE serialLogMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t serialLogTask = nullptr;
+static volatile bool serialLogPaused = false;  // Someone else owns the UART for now
+
+// Copy len bytes into the ring as one unit, or drop them all
+static bool serialLogWrite(const char* data, size_t len) {
+  bool accepted = false;
+
+  portENTER_CRITICAL(&serialLogMux);
+  uint32_t used = serialLogHead - serialLogTail;
+  if (len <= SERIAL_LOG_BYTES - used) {
+    uint32_t start = serialLogHead % SERIAL_LOG_BYTES;
+    size_t first = min(len, (size_t)(SERIAL_LOG_BYTES - start));
+    memcpy(serialLogRing + start, data, first);
+    memcpy(serialLogRing, data + first, len - first);
+    serialLogHead += len;
+    if (used + len > serialLogStats.highWater) {
+      serialLogStats.highWater = used + len;
+    }
+    serialLogStats.lines++;
+    accepted = true;
+  } else {
+    serialLogStats.droppedLines++;
+    serialLogStats.droppedBytes += len;
+  }
+  portEXIT_CRITICAL(&serialLogMux);
+
+  if (accepted && serialLogTask != nullptr) {
+    xTaskNotifyGive(serialLogTask);
+  }
+  return accepted;
+}
+
+// Queue one line (a newline is appended)
+static void logLine(const char* text) {
+  char line[SERIAL_LOG_CHUNK * 2];
+  size_t len = strnlen(text, sizeof(line) - 2);
+  memcpy(line, text, len);
+  line[len++] = '\r';
+  line[len++] = '\n';
+  serialLogWrite(line, len);
+}
+
+static void logLine(const String& text) {
+  logLine(text.c_str());
+}
+
+static void logPrintf(const char* format, ...) {
+  char line[SERIAL_LOG_CHUNK * 2];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(line, sizeof(line) - 2, format, args);
+  va_end(args);
+  if (len < 0) return;
+  len = min(len, (int)sizeof(line) - 3);
+  line[len++] = '\r';
+  line[len++] = '\n';
+  serialLogWrite(line, len);
+}
+
+static SerialLogStats serialLogSnapshot() {
+  portENTER_CRITICAL(&serialLogMux);
+  SerialLogStats snapshot = serialLogStats;
+  portEXIT_CRITICAL(&serialLogMux);
+  return snapshot;
+}
+
+// Bytes written to the UART so far (a position for serialLogHistory)
+static uint32_t serialLogDrained() {
+  portENTER_CRITICAL(&serialLogMux);
+  uint32_t tail = serialLogTail;
+  portEXIT_CRITICAL(&serialLogMux);
+  return tail;
+}
+
+// Copy up to max bytes of already-logged output from *cursor (a byte
+// position since boot) towards end, advancing *cursor. Output that has
+// since been overwritten is skipped. Returns 0 once *cursor reaches end.
+static size_t serialLogHistory(uint32_t* cursor, uint32_t end, char* out, size_t max) {
+  portENTER_CRITICAL(&serialLogMux);
+  uint32_t oldest = serialLogHead > SERIAL_LOG_BYTES ? serialLogHead - SERIAL_LOG_BYTES : 0;
+  if (*cursor < oldest) {
+    *cursor = oldest;
+  }
+  uint32_t start = *cursor % SERIAL_LOG_BYTES;
+  size_t len = *cursor < end ? min((size_t)(end - *cursor), max) : 0;
+  len = min(len, (size_t)(SERIAL_LOG_BYTES - start));
+  memcpy(out, serialLogRing + start, len);
+  *cursor += len;
+  portEXIT_CRITICAL(&serialLogMux);
+  return len;
+}
+
+static void serialLogDrain(void* unused) {
+  char chunk[SERIAL_LOG_CHUNK];
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+
+    while (!serialLogPaused) {
+      // Copy out under the lock, write to the UART without it
+      portENTER_CRITICAL(&serialLogMux);
+      uint32_t available = serialLogHead - serialLogTail;
+      uint32_t start = serialLogTail % SERIAL_LOG_BYTES;
+      size_t len = min((size_t)available, min((size_t)SERIAL_LOG_CHUNK,
+                                              (size_t)(SERIAL_LOG_BYTES - start)));
+      memcpy(chunk, serialLogRing + start, len);
+      uint32_t dropped = serialLogStats.droppedLines;
+      portEXIT_CRITICAL(&serialLogMux);
+
+      if (len == 0) {
+        if (dropped != serialLogReported) {
+          char notice[64];
+          int n = snprintf(notice, sizeof(notice), "[serial log: %lu lines dropped]\r\n",
+                           (unsigned long)(dropped - serialLogReported));
+          Serial.write((const uint8_t*)notice, n);
+          serialLogReported = dropped;
+        }
+        break;
+      }
+
+      Serial.write((const uint8_t*)chunk, len);  // Blocks this task only
+
+      portENTER_CRITICAL(&serialLogMux);
+      serialLogTail += len;
+      portEXIT_CRITICAL(&serialLogMux);
+    }
+  }
+}
+
+static void serialLogBegin() {
+  if (serialLogTask == nullptr) {
+    xTaskCreatePinnedToCore(serialLogDrain, "serialLog", 3072, nullptr,
+                            SERIAL_LOG_TASK_PRIORITY, &serialLogTask, SERIAL_LOG_TASK_CORE);
+  }
+}
+
+#endif  // SERIAL_LOG_H
@@ -18,6 +18,7 @@ LAMBDA_FUNCTION_NAME="SmartGardenAutomation"
 IOT_POLICY_NAME="SmartGardenPolicy"
 DYNAMODB_TABLE1="GardenSensorData"
 DYNAMODB_TABLE2="GardenActionLog"
+DYNAMODB_TABLE3="GardenSensorDataV2"
 SNS_TOPIC_NAME="GardenAlerts"
 
 echo -e "${GREEN}========================================${NC}"
@@ -141,6 +142,7 @@ create_dynamodb_tables() {
             AttributeName=deviceId,KeyType=HASH \
             AttributeName=timestamp,KeyType=RANGE \
         --billing-mode PAY_PER_REQUEST \
+        --stream-specification StreamEnabled=true,StreamViewType=NEW_IMAGE \
         --region ${REGION} 2>/dev/null || echo "Table ${DYNAMODB_TABLE1} already exists"
     
     # Table 2: Action Log
@@ -155,6 +157,25 @@ create_dynamodb_tables() {
         --billing-mode PAY_PER_REQUEST \
         --region ${REGION} 2>/dev/null || echo "Table ${DYNAMODB_TABLE2} already exists"
     
+    # Table 3: Sensor Data with binary device+day / millisecond keys
+    aws dynamodb create-table \
+        --table-name ${DYNAMODB_TABLE3} \
+        --attribute-definitions \
+            AttributeName=pk,AttributeType=B \
+            AttributeName=sk,AttributeType=B \
+        --key-schema \
+            AttributeName=pk,KeyType=HASH \
+            AttributeName=sk,KeyType=RANGE \
+        --billing-mode PAY_PER_REQUEST \
+        --region ${REGION} 2>/dev/null || echo "Table ${DYNAMODB_TABLE3} already exists"
+    
+    # Raw V2 items expire after RAW_RETENTION_DAYS (see storage_keys.py)
+    aws dynamodb wait table-exists --table-name ${DYNAMODB_TABLE3} --region ${REGION}
+    aws dynamodb update-time-to-live \
+        --table-name ${DYNAMODB_TABLE3} \
+        --time-to-live-specification Enabled=true,AttributeName=expiresAt \
+        --region ${REGION} 2>/dev/null || echo "TTL already enabled on ${DYNAMODB_TABLE3}"
+    
     echo -e "${GREEN}✓ DynamoDB tables created${NC}"
 }
 
@@ -262,6 +283,34 @@ create_iot_rule() {
         --source-arn "arn:aws:iot:${REGION}:${ACCOUNT_ID}:rule/ProcessGardenData" \
         --region ${REGION} 2>/dev/null || true
     
+    # HISTORY backfill blocks (garden/history/<deviceId>) go to the same
+    # function; topic() lets it tell them apart from telemetry
+    HISTORY_RULE_PAYLOAD='{
+      "sql": "SELECT *, topic() AS topic FROM '"'"'garden/history/+'"'"'",
+      "description": "Store device history backfill blocks",
+      "actions": [
+        {
+          "lambda": {
+            "functionArn": "'${LAMBDA_ARN}'"
+          }
+        }
+      ],
+      "ruleDisabled": false
+    }'
+    
+    aws iot create-topic-rule \
+        --rule-name ProcessGardenHistory \
+        --topic-rule-payload "${HISTORY_RULE_PAYLOAD}" \
+        --region ${REGION} 2>/dev/null || echo "Rule already exists"
+    
+    aws lambda add-permission \
+        --function-name ${LAMBDA_FUNCTION_NAME} \
+        --statement-id iot-invoke-history \
+        --action lambda:InvokeFunction \
+        --principal iot.amazonaws.com \
+        --source-arn "arn:aws:iot:${REGION}:${ACCOUNT_ID}:rule/ProcessGardenHistory" \
+        --region ${REGION} 2>/dev/null || true
+    
     echo -e "${GREEN}✓ IoT Rule created${NC}"
 }
 
@@ -2,16 +2,33 @@
  * Smart Garden System - Main Arduino Code
  * 
  * This code runs on ESP32/ESP8266 to:
- * - Read soil moisture sensor
- * - Control water pump via relay
+ * - Read soil moisture sensor (temperature compensated with a DS18B20)
+ * - Control water pump via relay (or a latching solenoid valve)
+ * - Dose nutrients with a stepper-driven peristaltic pump
  * - Communicate with AWS IoT Core
  * - Receive automated watering commands
  * 
  */
 
+#define ARDUINOJSON_USE_LONG_LONG 1  // 64-bit command trace IDs
+
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
+#include <Preferences.h>
+#include <ESPAsyncWebServer.h>
+#include <memory>
+#include <time.h>
+#include <mbedtls/base64.h>
+#include <esp_timer.h>
+#include <driver/rmt.h>
+#include <esp_adc_cal.h>
+#include <OneWire.h>
+#include <SPI.h>
+#include <Wire.h>
+#include "trace_buffer.h"
+#include "serial_log.h"
+#include "status_page_html.h"  // Generated by embed_web_assets.py
 
 // ============================================
 // Configuration - Update these values
@@ -26,25 +43,359 @@ const int mqtt_port = 8883;
 // MQTT Topics
 const char* telemetry_topic = "garden/telemetry";
 const char* command_topic = "garden/commands";
+const char* forecast_topic = "garden/forecast/tile/9q8yy";  // garden/forecast/tile/<geohash of DEVICE_LATITUDE/LONGITUDE>
+char history_topic[64];  // garden/history/<DEVICE_ID>, set in setup()
+const uint16_t MQTT_BUFFER_SIZE = 768;  // Fits a history block (default is 256)
+// Parsed command: ~12 fields plus one 16-byte slot per zone in "zones"
+// (MAX_ZONES), plus copied strings
+const size_t COMMAND_DOC_SIZE = 1024;
 
 // Pin definitions
 const int SOIL_SENSOR_PIN = 34;  // Analog pin for soil moisture sensor
 const int PUMP_RELAY_PIN = 5;    // Digital pin for relay control
 
-// Sensor calibration (update after calibrating your sensor)
-const int AIR_VALUE = 3000;      // Sensor reading in dry air
-const int WATER_VALUE = 1000;    // Sensor reading in water
-const int DRY_THRESHOLD = 2000;  // Below this = dry soil
-const int WET_THRESHOLD = 1000;  // Below this = wet soil
+// Latching solenoid valve on an H-bridge instead of the pump relay (see
+// wiring_diagram_doc.md). The valve flips on a short pulse and then holds
+// its position unpowered, so both bridge inputs rest LOW between pulses.
+const bool USE_LATCHING_VALVE = false;
+const int VALVE_OPEN_PIN = 25;          // H-bridge IN1: pulse HIGH to open
+const int VALVE_CLOSE_PIN = 26;         // H-bridge IN2: pulse HIGH to close
+const int VALVE_SENSE_PIN = 35;         // Coil current sense (shunt amp), -1 if not fitted
+const uint64_t VALVE_PULSE_US = 30000;  // Pulse length from the valve datasheet
+const int VALVE_SENSE_MIN = 400;        // Raw ADC at pulse end; below = coil not driven
+const uint8_t VALVE_MAX_ATTEMPTS = 2;   // Pulses per change before flagging a fault
+
+// Zone relay bank (see wiring_diagram_doc.md). Zone outputs live in a
+// shadow register; every change is written to the bank in one bus
+// transaction, and the hardware latches all outputs at once.
+const uint8_t RELAY_BANK_NONE = 0;
+const uint8_t RELAY_BANK_74HC595 = 1;   // Daisy-chained shift registers on SPI
+const uint8_t RELAY_BANK_MCP23017 = 2;  // I2C expander, 16 zones per chip
+const uint8_t RELAY_BANK = RELAY_BANK_NONE;
+const uint8_t ZONE_COUNT = 16;          // Up to MAX_ZONES
+const uint8_t MAX_ZONES = 32;
+const bool RELAY_BANK_ACTIVE_LOW = true;  // Most relay boards switch on a LOW input
+const int SR_DATA_PIN = 23;             // 74HC595 SER (VSPI MOSI)
+const int SR_CLOCK_PIN = 18;            // 74HC595 SRCLK (VSPI SCK)
+const int SR_LATCH_PIN = 19;            // 74HC595 RCLK
+const int SR_ENABLE_PIN = 4;            // 74HC595 /OE, held HIGH until the first commit
+const int EXPANDER_SDA_PIN = 21;
+const int EXPANDER_SCL_PIN = 22;
+const uint8_t EXPANDER_ADDRESS = 0x20;  // MCP23017 with A0-A2 tied LOW
+static_assert(ZONE_COUNT <= MAX_ZONES, "zone masks are 32 bits");
+
+// Nutrient dosing: peristaltic pump on a stepper driver (A4988/DRV8825/
+// TMC2208 in STEP/DIR mode). Step pulses come from the RMT peripheral, so
+// the dosed volume is an exact step count regardless of loop() timing.
+const bool USE_DOSER = false;
+const int DOSER_STEP_PIN = 27;
+const int DOSER_ENABLE_PIN = 13;        // Driver /EN: LOW only while dosing
+const rmt_channel_t DOSER_RMT_CHANNEL = RMT_CHANNEL_0;
+const uint32_t DOSER_STEP_HZ = 2000;    // Step rate (check the pump's max speed)
+const uint16_t DOSER_PULSE_US = 5;      // STEP high time
+const uint16_t DOSE_BATCH_STEPS = 128;  // Steps per RMT transmission
+const float DOSER_STEPS_PER_ML = 6400;  // Default until calibrated with DOSE CAL
+const float DOSE_MAX_ML = 250;
+const unsigned long DOSE_FLUSH_MS = 30000;  // Keep water running after a dose
+static_assert(RELAY_BANK != RELAY_BANK_MCP23017 || ZONE_COUNT <= 16, "one MCP23017 drives 16 zones");
+
+// Sensor calibration defaults in millivolts at the ADC pin (calibrate on
+// site with the CAL console command). Readings are converted with this
+// chip's eFuse ADC characterization, so these hold across boards.
+const int AIR_MV = 2500;            // Sensor output in dry air
+const int WATER_MV = 850;           // Sensor output in water
+const int DRY_THRESHOLD_MV = 1650;  // Below this = dry soil
+const int WET_THRESHOLD_MV = 850;   // Below this = wet soil
+
+// Calibration in use (loaded from NVS, see loadSettings)
+int airMv = AIR_MV;
+int waterMv = WATER_MV;
+
+// ADC characterization (see adcBegin): raw 12-bit reading -> mV at the pin
+const uint32_t ADC_DEFAULT_VREF_MV = 1100;  // Used only if the chip has no eFuse calibration
+const uint16_t ADC_MAX_RAW = 4095;
+uint16_t adcMvLut[ADC_MAX_RAW + 1];
+const char* adcCalSource = "none";
+// ADC1 is read from loop() (soil bursts) and from the esp_timer task (valve
+// coil sense); every analogRead() holds this so the two never interleave
+SemaphoreHandle_t adcMutex = nullptr;
+
+// Soil temperature compensation. Capacitive probe output drifts with soil
+// temperature; a DS18B20 next to the probe lets us correct each reading:
+//   mV -= (a * dT + b * dT^2) / 1000,  dT = T - TEMP_REF (°C)
+// with a in µV/°C and b in µV/°C² per probe (TEMPCOMP console command).
+// Everything is integer math on the sensor's native 1/16 °C units.
+const bool USE_SOIL_TEMP = false;
+const int ONEWIRE_PIN = 32;                  // DS18B20 DQ, 4.7kΩ pull-up to 3.3V
+const int16_t TEMP_REF_C16 = 20 * 16;        // Compensation reference: 20 °C
+const unsigned long TEMP_INTERVAL_MS = 10000;
+const unsigned long TEMP_CONVERSION_MS = 750;  // 12-bit conversion time
+const unsigned long TEMP_MAX_AGE_MS = 60000;   // Older readings are not used
 
 // Timing
 unsigned long lastPublish = 0;
-const long publishInterval = 60000;  // Publish every 60 seconds
+unsigned long lastMqttAttempt = 0;
+const unsigned long MQTT_RETRY_MS = 5000;  // Between reconnect attempts (loop keeps running)
+const unsigned long DEFAULT_PUBLISH_INTERVAL = 60000;  // Publish every 60 seconds
+unsigned long publishInterval = DEFAULT_PUBLISH_INTERVAL;
+const unsigned long LOOP_STALL_MS = 100;  // Loop iterations longer than this are marked in the trace
+
+// Soil sampling. WiFi TX bursts and pump/relay switching couple noise
+// into the ADC, so samples are taken on a fixed cadence but nudged into
+// quiet windows: no radio TX or output switching just before. A sample
+// that can't find a quiet window within SAMPLE_MAX_DEFER_MS is taken
+// anyway and flagged, so the sample rate never drops.
+const unsigned long SAMPLE_INTERVAL_MS = 1000;
+const unsigned long SAMPLE_MAX_DEFER_MS = 500;
+const unsigned long RADIO_QUIET_MS = 30;       // After our last MQTT transmit
+const unsigned long ACTUATION_SETTLE_MS = 500; // After a pump/valve/relay/doser change
+const uint8_t SAMPLE_BURST = 9;                // Readings per sample (median)
+const int SAMPLE_SPREAD_MAX = 80;              // Burst max-min above this = disturbed
+
+// sampleFlags in telemetry
+const uint8_t SAMPLE_PUMP_ON = 0x01;   // Water pump or a zone was running
+const uint8_t SAMPLE_DOSING = 0x02;    // Doser stepper was running
+const uint8_t SAMPLE_FORCED = 0x04;    // No quiet window before the deadline
+const uint8_t SAMPLE_SPREAD = 0x08;    // Burst readings disagreed (noise hit the burst)
 
 // Device info
 const char* DEVICE_ID = "garden_sensor_01";
 const char* FIRMWARE_VERSION = "1.0.0";
 
+// Site location (used by the backend to pick the weather tile)
+const float DEVICE_LATITUDE = 37.7749;
+const float DEVICE_LONGITUDE = -122.4194;
+
+// Latest regional forecast (retained message on forecast_topic)
+struct Forecast {
+  bool valid;
+  float temperature;         // °C
+  int humidity;              // %
+  int rainProbability;       // %
+  unsigned long issuedAt;    // Unix time the backend published it
+  unsigned long receivedAt;  // millis() when we received it
+};
+Forecast forecast = {false, 0, 0, 0, 0, 0};
+
+// Trace ID of the last command, echoed in telemetry so the backend can
+// link commands to actual pump runs
+unsigned long long lastTraceId = 0;
+
+// Latching valve state. Pulses end in an esp_timer callback; loop()
+// checks the current sample it took and updates valveState.
+enum ValveState : uint8_t { VALVE_UNKNOWN, VALVE_CLOSED, VALVE_OPEN };
+ValveState valveState = VALVE_UNKNOWN;   // Last verified position
+ValveState valveTarget = VALVE_CLOSED;   // Commanded position
+ValveState valvePulsing = VALVE_UNKNOWN; // Direction of the pulse in flight
+esp_timer_handle_t valvePulseTimer = nullptr;
+volatile bool valvePulseActive = false;
+volatile bool valvePulseDone = false;
+volatile int valvePulseSense = -1;
+uint8_t valveAttempts = 0;
+bool valveFault = false;
+unsigned long valvePulses = 0;
+
+// Zone outputs: bit n = zone n+1
+uint32_t zoneShadow = 0;      // Wanted state
+uint32_t zoneLatched = 0;     // Last state written to the bank
+bool zoneBankDirty = false;   // Last write failed; retried from loop()
+bool zoneBankReady = false;   // Outputs enabled after the first good write
+unsigned long zoneRetryAt = 0;
+unsigned long zoneWrites = 0;
+unsigned long zoneWriteErrors = 0;
+uint32_t zoneTimed = 0;       // Zones with an auto-off deadline
+unsigned long zoneOffAt[MAX_ZONES];
+
+// Dosing state. The dose task queues one RMT batch at a time; the RMT
+// tx-end interrupt wakes it for the next. loop() handles start/finish.
+float stepsPerMl = DOSER_STEPS_PER_ML;   // Calibration (NVS "steps_ml")
+rmt_item32_t doseItems[DOSE_BATCH_STEPS];
+TaskHandle_t doseTask = nullptr;
+portMUX_TYPE doseMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool doseActive = false;
+volatile bool doseStopRequested = false;
+volatile bool doseFinished = false;
+volatile uint32_t doseRemaining = 0;     // Steps not yet queued
+volatile uint32_t doseSent = 0;          // Steps queued to the RMT
+uint32_t doseTotal = 0;
+uint32_t lastDoseSteps = 0;              // For DOSE CAL
+unsigned long doseCount = 0;
+
+// DS18B20 state (see tempPoll)
+OneWire oneWire(ONEWIRE_PIN);
+bool tempConverting = false;
+unsigned long tempRequestedAt = 0;
+unsigned long nextTempAt = 0;
+bool soilTempValid = false;
+int16_t soilTempC16 = 0;           // 1/16 °C
+unsigned long soilTempAt = 0;      // millis()
+unsigned long tempReadErrors = 0;
+int32_t tempCoefA = 0;             // µV/°C (NVS "tc_a")
+int32_t tempCoefB = 0;             // µV/°C² (NVS "tc_b")
+
+// Latest soil sample (see samplerPoll)
+struct SoilSample {
+  bool valid;
+  int raw;                  // Burst median
+  int mv;                   // raw through the ADC calibration LUT, temperature compensated
+  uint16_t spread;          // Burst max - min
+  uint8_t flags;            // SAMPLE_*
+  unsigned long takenAt;    // millis()
+};
+SoilSample soilSample = {false, 0, 0, 0, 0, 0};
+unsigned long nextSampleAt = 0;
+unsigned long lastRadioTx = 0;     // millis() of our last MQTT transmit
+unsigned long lastActuation = 0;   // millis() of the last output change
+unsigned long samplesQuiet = 0;
+unsigned long samplesForced = 0;
+
+// Pump auto-off deadline for WATER_ON with a duration (checked in loop())
+bool pumpTimerActive = false;
+unsigned long pumpOffAt = 0;      // millis()
+unsigned long pumpStartedAt = 0;  // millis()
+
+// Scheduled commands (WATER_ON/WATER_OFF with an "at" Unix time), kept in
+// a hashed timer wheel with 1 s ticks: an entry lives in slot at % slots,
+// so insert is O(1) and each tick only looks at one slot. The entry pool
+// is persisted to NVS so schedules survive reboots and fire while MQTT is
+// down. Firing needs wall-clock time: after a power cycle the wheel waits
+// until SNTP has set the clock once (there is no RTC on the board), so a
+// device that boots with no network runs its schedule once it syncs.
+const uint8_t WHEEL_SLOTS = 64;
+const uint8_t MAX_SCHEDULED = 32;
+const uint32_t SCHEDULE_MAX_LATE_S = 3600;  // Drop commands missed by more than this
+const int8_t TIMER_NONE = -1;
+
+struct ScheduledCommand {
+  uint64_t traceId;
+  uint32_t at;         // Unix time
+  uint32_t id;         // scheduleId, for CANCEL
+  uint32_t zones;      // Zone mask, 0 = the pump
+  uint16_t duration;   // Seconds (WATER_ON)
+  uint16_t doseMl10;   // Nutrient dose in 0.1 ml (WATER_ON)
+  uint8_t action;      // SCHEDULED_*, 0 = free entry
+  int8_t next;         // Next entry in the same slot (or free list)
+};
+const uint8_t SCHEDULED_WATER_ON = 1;
+const uint8_t SCHEDULED_WATER_OFF = 2;
+
+ScheduledCommand scheduled[MAX_SCHEDULED];
+int8_t wheel[WHEEL_SLOTS];     // First entry per slot
+int8_t scheduledFree = TIMER_NONE;
+uint8_t scheduledCount = 0;
+uint32_t wheelTime = 0;        // Last second processed (0 until the clock is set)
+
+// On-device history of published readings, served by /api/history.
+// 8 bytes per sample, also the binary wire format (little-endian).
+struct HistorySample {
+  uint32_t time;            // Unix time, or uptime seconds before NTP sync
+  uint16_t soilMoisture;    // Raw ADC reading
+  uint8_t moisturePercent;
+  uint8_t flags;            // HISTORY_* bits
+};
+const uint8_t HISTORY_PUMP_ON = 0x01;
+const uint8_t HISTORY_TIME_UPTIME = 0x02;  // time is seconds since boot
+const uint32_t HISTORY_SAMPLES = 1440;     // 24 h at the default publish interval
+HistorySample history[HISTORY_SAMPLES];
+uint32_t historyCount = 0;                 // Samples ever recorded
+portMUX_TYPE historyMux = portMUX_INITIALIZER_UNLOCKED;  // Web handlers run on another task
+
+// HISTORY backfill: compressed blocks of history samples streamed to
+// history_topic. At most HISTORY_WINDOW blocks are unacknowledged at a
+// time and blocks are spaced at least HISTORY_SEND_INTERVAL_MS apart, so a
+// backfill can't crowd out telemetry. The backend acks each stored block
+// with HISTORY_ACK; acks are selective (its Lambda invocations run in any
+// order), and on an ack timeout only the unacknowledged blocks are resent.
+const uint32_t HISTORY_WINDOW = 4;
+const size_t HISTORY_BLOCK_BYTES = 320;           // Encoded bytes per block
+const unsigned long HISTORY_SEND_INTERVAL_MS = 200;
+const unsigned long HISTORY_ACK_TIMEOUT_MS = 15000;
+const uint8_t HISTORY_MAX_RETRIES = 3;
+
+struct HistoryTransfer {
+  bool active;
+  bool finished;           // Last block has been sent
+  uint32_t requestId;
+  uint32_t from;           // Unix time range, inclusive
+  uint32_t to;
+  uint32_t cursor;         // Next history sample to encode
+  uint32_t nextBlock;      // Next block number to send
+  uint32_t ackedBlocks;    // Blocks below this number are acknowledged
+  uint32_t ackedMask;      // Bit i: block ackedBlocks + i acknowledged out of order
+  uint32_t resendBlock;    // Next block to resend after an ack timeout
+  uint32_t blockStart[HISTORY_WINDOW];  // cursor at each unacked block, for resends
+  unsigned long lastSend;
+  unsigned long lastAck;
+  uint8_t retries;
+};
+HistoryTransfer historyTransfer = {};
+
+// Local status page (port 80)
+AsyncWebServer webServer(80);
+
+// /api/status data, copied from loop() state once a second. Handlers run
+// on the AsyncTCP task, so they read only this copy (under statusMux) and
+// never touch the MQTT client, WiFi or loop() state directly.
+struct StatusSnapshot {
+  uint32_t uptime;          // Seconds
+  uint32_t time;            // Unix time
+  bool haveSample;
+  uint8_t moisturePercent;
+  uint16_t soilMoisture;
+  bool pumpOn;
+  int rssi;
+  bool mqttConnected;
+  uint32_t freeHeap;
+  uint32_t historySamples;
+  bool forecastValid;
+  float forecastTemperature;
+  int forecastHumidity;
+  int forecastRain;
+};
+StatusSnapshot statusSnapshot = {};
+portMUX_TYPE statusMux = portMUX_INITIALIZER_UNLOCKED;
+unsigned long lastStatusSnapshot = 0;
+const unsigned long STATUS_SNAPSHOT_MS = 1000;
+
+// Per-request cursor for streaming /api/history in chunks
+struct HistoryStream {
+  uint32_t next;          // Sequence number of the next sample
+  uint32_t end;           // Newest sample + 1 when the request arrived
+  bool binary;
+  bool started;
+  bool finished;
+  char pending[64];       // Encoded sample that didn't fit the last chunk
+  size_t pendingLength;
+  size_t pendingOffset;
+};
+
+// Runtime counters (STATS console command)
+unsigned long publishCount = 0;
+unsigned long publishFailures = 0;
+unsigned long commandCount = 0;
+unsigned long loopStalls = 0;
+
+// Serial console: input is read a few bytes per loop() pass
+const size_t CONSOLE_LINE_MAX = 96;
+const int CONSOLE_READ_BUDGET = 64;  // Bytes consumed per loop() pass
+char consoleLine[CONSOLE_LINE_MAX];
+size_t consoleLength = 0;
+bool consoleOverflow = false;
+
+// LOG replay in progress: streamed straight to the UART, one chunk per
+// loop() pass, only as fast as the TX FIFO has room
+bool consoleLogActive = false;
+uint32_t consoleLogCursor = 0;
+uint32_t consoleLogEnd = 0;
+
+// TRACE_DUMP in progress: streamed the same way, a few lines per pass
+const int TRACE_DUMP_LINES_PER_PASS = 8;
+bool traceDumpStreaming = false;
+char traceDumpText[96];
+size_t traceDumpLength = 0;  // Formatted line still waiting for TX room
+
+Preferences prefs;
+
 WiFiClientSecure espClient;
 PubSubClient client(espClient);
 
@@ -78,6 +429,7 @@ PASTE_CONTENTS_OF_private.pem.key
 // ============================================
 void setup() {
   Serial.begin(115200);
+  serialLogBegin();
   delay(1000);
   
   Serial.println("\n\n========================================");
@@ -85,18 +437,43 @@ void setup() {
   Serial.println("Version: " + String(FIRMWARE_VERSION));
   Serial.println("========================================\n");
   
+  adcBegin();
+  
   // Initialize pins
-  pinMode(PUMP_RELAY_PIN, OUTPUT);
-  digitalWrite(PUMP_RELAY_PIN, LOW);  // Pump off initially
+  if (USE_LATCHING_VALVE) {
+    valveBegin();  // Pulses the valve closed: its position is unknown after a reset
+  } else {
+    pinMode(PUMP_RELAY_PIN, OUTPUT);
+    digitalWrite(PUMP_RELAY_PIN, LOW);  // Pump off initially
+  }
   pinMode(SOIL_SENSOR_PIN, INPUT);
+  if (RELAY_BANK != RELAY_BANK_NONE) {
+    relayBankBegin();
+  }
+  if (USE_DOSER) {
+    doseBegin();
+  }
   
   Serial.println("✓ Pins initialized");
   Serial.println("  - Soil Sensor: GPIO" + String(SOIL_SENSOR_PIN));
-  Serial.println("  - Pump Relay: GPIO" + String(PUMP_RELAY_PIN));
+  if (USE_LATCHING_VALVE) {
+    Serial.println("  - Latching Valve: open GPIO" + String(VALVE_OPEN_PIN) +
+                   ", close GPIO" + String(VALVE_CLOSE_PIN));
+  } else {
+    Serial.println("  - Pump Relay: GPIO" + String(PUMP_RELAY_PIN));
+  }
+  
+  loadSettings();
+  loadSchedule();
   
   // Connect to WiFi
   connectWiFi();
   
+  // UTC wall-clock time for history samples; SNTP syncs in the background
+  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+  
+  startWebServer();
+  
   // Configure AWS IoT certificates
   espClient.setCACert(root_ca);
   espClient.setCertificate(certificate);
@@ -105,23 +482,63 @@ void setup() {
   // Connect to AWS IoT
   client.setServer(mqtt_server, mqtt_port);
   client.setCallback(messageCallback);
+  client.setBufferSize(MQTT_BUFFER_SIZE);
+  snprintf(history_topic, sizeof(history_topic), "garden/history/%s", DEVICE_ID);
   
-  connectAWSIoT();
+  lastMqttAttempt = millis();
+  connectAWSIoT();  // One attempt; loop() keeps retrying
   
   Serial.println("\n✓ System ready!");
   Serial.println("Device ID: " + String(DEVICE_ID));
   Serial.println("\nStarting sensor monitoring...\n");
+  Serial.println("Type HELP for console commands\n");
 }
 
 // ============================================
 // Main Loop
 // ============================================
 void loop() {
-  // Ensure MQTT connection
-  if (!client.connected()) {
+  TRACE_BEGIN("loop");
+  unsigned long loopStart = millis();
+  
+  // Before client.loop(), which may transmit
+  samplerPoll();
+  
+  // Local control first: none of it may wait on the network
+  consolePoll();
+  
+  if (USE_LATCHING_VALVE) {
+    valvePoll();
+  }
+  if (RELAY_BANK != RELAY_BANK_NONE) {
+    zonePoll();
+  }
+  if (USE_DOSER) {
+    dosePoll();
+  }
+  if (USE_SOIL_TEMP) {
+    tempPoll();
+  }
+  
+  // Non-blocking pump auto-off
+  if (pumpTimerActive && (long)(millis() - pumpOffAt) >= 0) {
+    pumpTimerActive = false;
+    setPump(false);
+    TRACE_INSTANT("pump.off");
+    logPrintf("💧 Pump turned OFF after %lus", (millis() - pumpStartedAt) / 1000);
+    publishSensorData();  // Ack: report the pump stopped
+  }
+  
+  advanceTimerWheel();
+  
+  // Ensure MQTT connection (one attempt per MQTT_RETRY_MS)
+  if (!client.connected() && millis() - lastMqttAttempt >= MQTT_RETRY_MS) {
+    lastMqttAttempt = millis();
     connectAWSIoT();
   }
+  TRACE_BEGIN("client.loop");
   client.loop();
+  TRACE_END("client.loop");
   
   // Publish sensor data periodically
   if (millis() - lastPublish > publishInterval) {
@@ -129,6 +546,20 @@ void loop() {
     lastPublish = millis();
   }
   
+  // At most one backfill block per pass, after telemetry
+  historyPump();
+  
+  if (millis() - lastStatusSnapshot >= STATUS_SNAPSHOT_MS) {
+    lastStatusSnapshot = millis();
+    updateStatusSnapshot();
+  }
+  
+  if (millis() - loopStart > LOOP_STALL_MS) {
+    TRACE_INSTANT("loop.stall");
+    loopStalls++;
+  }
+  TRACE_END("loop");
+  
   // Small delay to prevent watchdog issues
   delay(10);
 }
@@ -165,75 +596,117 @@ void connectWiFi() {
 // ============================================
 // AWS IoT Connection
 // ============================================
-void connectAWSIoT() {
-  while (!client.connected()) {
-    Serial.print("Connecting to AWS IoT Core...");
+// Single attempt; the caller retries. The TLS handshake itself can still
+// take a few seconds to time out, so skip it while WiFi is down.
+bool connectAWSIoT() {
+  TRACE_SCOPE("connectAWSIoT");
+  if (WiFi.status() != WL_CONNECTED) {
+    return false;
+  }
+  
+  logLine("Connecting to AWS IoT Core...");
+  
+  // Generate unique client ID
+  String clientId = "ESP32_Garden_" + String(random(0xffff), HEX);
+  
+  TRACE_BEGIN("mqtt.connect");  // includes the TLS handshake
+  bool connected = client.connect(clientId.c_str());
+  TRACE_END("mqtt.connect");
+  lastRadioTx = millis();
+  
+  if (connected) {
+    logLine("✓ AWS IoT connected!");
     
-    // Generate unique client ID
-    String clientId = "ESP32_Garden_" + String(random(0xffff), HEX);
+    // Subscribe to command topic
+    if (client.subscribe(command_topic)) {
+      logPrintf("✓ Subscribed to: %s", command_topic);
+    }
     
-    if (client.connect(clientId.c_str())) {
-      Serial.println(" connected!");
-      
-      // Subscribe to command topic
-      if (client.subscribe(command_topic)) {
-        Serial.println("✓ Subscribed to: " + String(command_topic));
-      }
-      
-      // Publish initial status
-      publishSensorData();
-      
-    } else {
-      Serial.print(" failed, rc=");
-      Serial.print(client.state());
-      Serial.println(" retrying in 5 seconds...");
-      
-      // Error codes:
-      // -4 : MQTT_CONNECTION_TIMEOUT
-      // -3 : MQTT_CONNECTION_LOST
-      // -2 : MQTT_CONNECT_FAILED
-      // -1 : MQTT_DISCONNECTED
-      
-      delay(5000);
+    // Subscribe to regional forecast (broker replays the retained copy)
+    if (client.subscribe(forecast_topic, 1)) {
+      logPrintf("✓ Subscribed to: %s", forecast_topic);
     }
+    
+    // Publish initial status
+    publishSensorData();
+    
+  } else {
+    logPrintf("✗ AWS IoT connect failed, rc=%d retrying in %lu seconds...", client.state(),
+              MQTT_RETRY_MS / 1000);
+    
+    // Error codes:
+    // -4 : MQTT_CONNECTION_TIMEOUT
+    // -3 : MQTT_CONNECTION_LOST
+    // -2 : MQTT_CONNECT_FAILED
+    // -1 : MQTT_DISCONNECTED
   }
+  return connected;
 }
 
 // ============================================
 // Read and Publish Sensor Data
 // ============================================
 void publishSensorData() {
-  // Read soil moisture sensor
-  int soilMoisture = analogRead(SOIL_SENSOR_PIN);
+  TRACE_SCOPE("publishSensorData");
   
-  // Convert to percentage (0-100%)
-  int moisturePercent = map(soilMoisture, AIR_VALUE, WATER_VALUE, 0, 100);
-  moisturePercent = constrain(moisturePercent, 0, 100);
+  // Latest quiet-window sample, not a reading next to the TLS transmit
+  if (!soilSample.valid) {
+    takeSoilSample(SAMPLE_FORCED);
+  }
+  int soilMoisture = soilSample.raw;
+  int moisturePercent = moisturePercentFromMv(soilSample.mv);
   
   // Get pump status
-  bool pumpOn = digitalRead(PUMP_RELAY_PIN);
+  bool pumpOn = pumpIsOn();
   
   // Create JSON payload
-  StaticJsonDocument<256> doc;
+  StaticJsonDocument<384> doc;
   doc["deviceId"] = DEVICE_ID;
   doc["soilMoisture"] = soilMoisture;
+  doc["soilMv"] = soilSample.mv;
+  if (soilTempFresh()) {
+    doc["soilTemp"] = soilTempC16 / 16.0;
+  }
   doc["moisturePercent"] = moisturePercent;
   doc["pumpStatus"] = pumpOn ? "ON" : "OFF";
   doc["timestamp"] = millis();
   doc["rssi"] = WiFi.RSSI();
   doc["firmwareVersion"] = FIRMWARE_VERSION;
+  doc["lat"] = DEVICE_LATITUDE;
+  doc["lon"] = DEVICE_LONGITUDE;
+  if (lastTraceId != 0) {
+    doc["traceId"] = lastTraceId;
+  }
+  if (valveFault) {
+    doc["valveFault"] = true;
+  }
+  if (RELAY_BANK != RELAY_BANK_NONE) {
+    doc["zones"] = zoneShadow;
+  }
+  doc["sampleFlags"] = soilSample.flags;
   
-  char jsonBuffer[256];
-  serializeJson(doc, jsonBuffer);
+  char jsonBuffer[384];
+  serializeJson(doc, jsonBuffer, sizeof(jsonBuffer));
   
   // Publish to AWS IoT
-  if (client.publish(telemetry_topic, jsonBuffer)) {
-    Serial.println("📤 Data published:");
-    Serial.println("   Moisture: " + String(moisturePercent) + "% (raw: " + String(soilMoisture) + ")");
-    Serial.println("   Pump: " + String(pumpOn ? "ON" : "OFF"));
-    Serial.println("   Topic: " + String(telemetry_topic));
+  TRACE_BEGIN("mqtt.publish");
+  bool published = client.publish(telemetry_topic, jsonBuffer);
+  TRACE_END("mqtt.publish");
+  lastRadioTx = millis();
+  TRACE_COUNTER("freeHeap", ESP.getFreeHeap());
+  
+  recordHistory(soilMoisture, moisturePercent, pumpOn);
+  
+  if (published) {
+    publishCount++;
+    logLine("📤 Data published:");
+    logPrintf("   Moisture: %d%% (%d mV, raw %d, flags 0x%02x)", moisturePercent, soilSample.mv,
+              soilMoisture, soilSample.flags);
+    logPrintf("   Pump: %s", pumpOn ? "ON" : "OFF");
+    logPrintf("   Topic: %s", telemetry_topic);
   } else {
-    Serial.println("✗ Publish failed!");
+    publishFailures++;
+    logLine("✗ Publish failed!");
   }
 }
 
@@ -241,51 +714,1603 @@ void publishSensorData() {
 // Handle Incoming MQTT Messages
 // ============================================
 void messageCallback(char* topic, byte* payload, unsigned int length) {
-  Serial.println("\n📥 Message received on topic: " + String(topic));
+  TRACE_SCOPE("messageCallback");
+  logPrintf("📥 Message received on topic: %s", topic);
   
   // Parse JSON command
-  StaticJsonDocument<256> doc;
+  StaticJsonDocument<COMMAND_DOC_SIZE> doc;
   DeserializationError error = deserializeJson(doc, payload, length);
   
   if (error) {
-    Serial.println("✗ JSON parsing failed: " + String(error.c_str()));
+    logPrintf("✗ JSON parsing failed: %s", error.c_str());
     return;
   }
   
-  const char* action = doc["action"];
+  if (strcmp(topic, forecast_topic) == 0) {
+    updateForecast(doc);
+    return;
+  }
+  
+  // Commands may target a single device; ignore ones meant for others
+  const char* targetDevice = doc["deviceId"];
+  if (targetDevice != nullptr && strcmp(targetDevice, DEVICE_ID) != 0) {
+    return;
+  }
   
+  handleCommand(doc);
+}
+
+// ============================================
+// Execute a Command (MQTT or serial console)
+// ============================================
+void handleCommand(const JsonDocument& doc) {
+  const char* action = doc["action"];
+
   if (action == nullptr) {
-    Serial.println("✗ No action specified in command");
+    logLine("✗ No action specified in command");
+    return;
+  }
+  
+  logPrintf("Action: %s", action);
+  commandCount++;
+  
+  // Future pump commands wait in the timer wheel
+  bool pumpAction = strcmp(action, "WATER_ON") == 0 || strcmp(action, "WATER_OFF") == 0;
+  if (pumpAction && doc.containsKey("at") && doc["at"].as<uint32_t>() > (uint32_t)time(nullptr)) {
+    scheduleCommand(doc);
     return;
   }
   
-  Serial.println("Action: " + String(action));
+  if (doc.containsKey("traceId")) {
+    lastTraceId = doc["traceId"].as<unsigned long long>();
+  }
   
   // Process commands
-  if (strcmp(action, "WATER_ON") == 0) {
-    digitalWrite(PUMP_RELAY_PIN, HIGH);
-    Serial.println("💧 Pump turned ON");
+  if (strcmp(action, "WATER_ON") == 0 && commandZones(doc) != 0) {
+    waterZones(commandZones(doc), doc["duration"] | 0);
+    if (doc.containsKey("doseMl")) {
+      startDose(doc["doseMl"]);
+    }
+  }
+  else if (strcmp(action, "WATER_OFF") == 0 && commandZones(doc) != 0) {
+    stopZones(commandZones(doc));
+  }
+  else if (strcmp(action, "WATER_ON") == 0) {
+    setPump(true);
+    TRACE_INSTANT("pump.on");
+    logLine("💧 Pump turned ON");
+    publishSensorData();  // Ack: report the pump running
     
-    // Auto turn off after duration (if specified)
+    // Auto turn off after duration (if specified); loop() does the off
+    pumpStartedAt = millis();
     if (doc.containsKey("duration")) {
       int duration = doc["duration"];
-      Serial.println("   Duration: " + String(duration) + " seconds");
-      delay(duration * 1000);
-      digitalWrite(PUMP_RELAY_PIN, LOW);
-      Serial.println("💧 Pump turned OFF after " + String(duration) + "s");
+      logPrintf("   Duration: %d seconds", duration);
+      pumpOffAt = pumpStartedAt + (unsigned long)duration * 1000;
+      pumpTimerActive = true;
+    } else {
+      pumpTimerActive = false;
+    }
+    if (doc.containsKey("doseMl")) {
+      startDose(doc["doseMl"]);
     }
+    return;  // Already reported
   } 
   else if (strcmp(action, "WATER_OFF") == 0) {
-    digitalWrite(PUMP_RELAY_PIN, LOW);
-    Serial.println("🛑 Pump turned OFF");
+    pumpTimerActive = false;
+    setPump(false);
+    TRACE_INSTANT("pump.off");
+    logLine("🛑 Pump turned OFF");
+    if (zoneShadow != 0) {
+      stopZones(zoneShadow);  // Plain WATER_OFF stops everything
+    }
   }
   else if (strcmp(action, "STATUS") == 0) {
-    Serial.println("📊 Status requested - publishing data...");
+    logLine("📊 Status requested - publishing data...");
+  }
+  else if (strcmp(action, "TRACE_DUMP") == 0) {
+    // Capture the serial output and run trace_to_perfetto.py on it
+    startTraceDump();
+    return;
+  }
+  else if (strcmp(action, "HISTORY") == 0) {
+    startHistoryTransfer(doc);
+    return;
+  }
+  else if (strcmp(action, "HISTORY_ACK") == 0) {
+    ackHistoryBlock(doc);
+    return;
+  }
+  else if (strcmp(action, "DOSE") == 0) {
+    // Nutrient dose; starts the pump first if no water is flowing
+    startDose(doc["ml"] | 0.0f);
+    return;
+  }
+  else if (strcmp(action, "DOSE_STOP") == 0) {
+    stopDose("stop command");
+    return;
+  }
+  else if (strcmp(action, "CANCEL") == 0) {
+    // Cancel one scheduled command, or all of them without a scheduleId
+    cancelScheduled(doc["scheduleId"] | 0UL);
+    return;
   }
   else {
-    Serial.println("⚠ Unknown action: " + String(action));
+    logPrintf("⚠ Unknown action: %s", action);
   }
   
   // Publish status update
   publishSensorData();
 }
+
+// ============================================
+// Cache Regional Forecast
+// ============================================
+void updateForecast(const JsonDocument& doc) {
+  forecast.temperature = doc["t"] | 25.0f;
+  forecast.humidity = doc["h"] | 50;
+  forecast.rainProbability = doc["r"] | 0;
+  forecast.issuedAt = doc["ts"] | 0UL;
+  forecast.receivedAt = millis();
+  forecast.valid = true;
+  
+  logPrintf("🌤️  Forecast: %.1f°C, rain %d%%", forecast.temperature, forecast.rainProbability);
+}
+
+// ============================================
+// Persistent Settings (NVS)
+// ============================================
+void loadSettings() {
+  prefs.begin("garden", false);
+  airMv = prefs.getInt("air_mv", AIR_MV);
+  waterMv = prefs.getInt("water_mv", WATER_MV);
+  publishInterval = prefs.getULong("interval", DEFAULT_PUBLISH_INTERVAL);
+  stepsPerMl = prefs.getFloat("steps_ml", DOSER_STEPS_PER_ML);
+  tempCoefA = prefs.getInt("tc_a", 0);
+  tempCoefB = prefs.getInt("tc_b", 0);
+  
+  Serial.println("✓ Settings loaded");
+  Serial.println("  - Calibration: air=" + String(airMv) + "mV water=" + String(waterMv) + "mV");
+  Serial.println("  - Publish interval: " + String(publishInterval / 1000) + "s");
+}
+
+// ============================================
+// Serial Console
+// ============================================
+// Line-based console for field technicians on the USB port. Input is
+// consumed without blocking from loop(); replies go through the async
+// serial log, and the long LOG replay and TRACE_DUMP are streamed in chunks.
+void consolePoll() {
+  if (consoleLogActive) {
+    consoleStreamLog();
+  } else if (traceDumpStreaming) {
+    consoleStreamTrace();
+  }
+  
+  for (int budget = CONSOLE_READ_BUDGET; budget > 0 && Serial.available() > 0; budget--) {
+    char c = (char)Serial.read();
+    
+    if (c == '\r' || c == '\n') {
+      if (consoleOverflow) {
+        logLine("✗ Console line too long");
+      } else if (consoleLength > 0) {
+        consoleLine[consoleLength] = '\0';
+        consoleExecute(consoleLine);
+      }
+      consoleLength = 0;
+      consoleOverflow = false;
+    } else if (c == '\b' || c == 0x7f) {
+      if (consoleLength > 0) consoleLength--;
+    } else if (consoleLength < CONSOLE_LINE_MAX - 1) {
+      consoleLine[consoleLength++] = c;
+    } else {
+      consoleOverflow = true;
+    }
+  }
+}
+
+void consoleExecute(char* line) {
+  TRACE_SCOPE("consoleExecute");
+  char* verb = strtok(line, " \t");
+  char* arg1 = strtok(nullptr, " \t");
+  char* arg2 = strtok(nullptr, " \t");
+  char* arg3 = strtok(nullptr, " \t");
+  if (verb == nullptr) return;
+  for (char* p = verb; *p; p++) *p = toupper(*p);
+  
+  if (strcmp(verb, "HELP") == 0) {
+    logLine("Commands:");
+    logLine("  WATER_ON [seconds]   WATER_OFF   STATUS   TRACE_DUMP");
+    logLine("  SCHEDULE             list scheduled commands (CANCEL [id] to drop)");
+    logLine("  ZONE n ON [seconds] | ZONE n OFF");
+    logLine("  DOSE ml | DOSE STOP | DOSE CAL measured_ml");
+    logLine("  TEMPCOMP [a b]        soil temperature compensation (µV/°C, µV/°C²)");
+    logLine("  STATS                 runtime counters");
+    logLine("  CAL [AIR|WATER [mV]]  show or set sensor calibration (RESET for defaults)");
+    logLine("  CONFIG [INTERVAL s]   show config or set the publish interval");
+    logLine("  LOG                   replay recent log output");
+  }
+  else if (strcmp(verb, "WATER_ON") == 0 || strcmp(verb, "WATER_OFF") == 0 ||
+           strcmp(verb, "STATUS") == 0 || strcmp(verb, "TRACE_DUMP") == 0) {
+    // Same path as an MQTT command
+    StaticJsonDocument<128> doc;
+    doc["action"] = verb;
+    if (arg1 != nullptr) {
+      doc["duration"] = atoi(arg1);
+    }
+    handleCommand(doc);
+  }
+  else if (strcmp(verb, "ZONE") == 0 && arg1 != nullptr && arg2 != nullptr) {
+    for (char* p = arg2; *p; p++) *p = toupper(*p);
+    StaticJsonDocument<128> doc;
+    doc["action"] = strcmp(arg2, "ON") == 0 ? "WATER_ON" : "WATER_OFF";
+    doc["zone"] = atoi(arg1);
+    if (arg3 != nullptr) {
+      doc["duration"] = atoi(arg3);
+    }
+    handleCommand(doc);
+  }
+  else if (strcmp(verb, "DOSE") == 0) {
+    consoleDose(arg1, arg2);
+  }
+  else if (strcmp(verb, "TEMPCOMP") == 0) {
+    consoleTempComp(arg1, arg2);
+  }
+  else if (strcmp(verb, "STATS") == 0) {
+    consoleStats();
+  }
+  else if (strcmp(verb, "SCHEDULE") == 0) {
+    listScheduled();
+  }
+  else if (strcmp(verb, "CANCEL") == 0) {
+    cancelScheduled(arg1 != nullptr ? strtoul(arg1, nullptr, 10) : 0);
+  }
+  else if (strcmp(verb, "CAL") == 0) {
+    consoleCalibrate(arg1, arg2);
+  }
+  else if (strcmp(verb, "CONFIG") == 0) {
+    consoleConfig(arg1, arg2);
+  }
+  else if (strcmp(verb, "LOG") == 0) {
+    consoleLogCursor = 0;
+    consoleLogEnd = serialLogDrained();
+    consoleLogActive = true;
+    serialLogPaused = true;  // Keep live output from interleaving with the replay
+    Serial.println("----- log replay -----");
+  }
+  else {
+    logPrintf("⚠ Unknown command: %s (try HELP)", verb);
+  }
+}
+
+void consoleStreamLog() {
+  char chunk[SERIAL_LOG_CHUNK];
+  int room = Serial.availableForWrite();
+  if (room <= 0) return;
+  
+  size_t len = serialLogHistory(&consoleLogCursor, consoleLogEnd, chunk,
+                                min((size_t)room, sizeof(chunk)));
+  if (len > 0) {
+    Serial.write((const uint8_t*)chunk, len);
+    return;
+  }
+  
+  consoleLogActive = false;
+  serialLogPaused = traceDumpStreaming;
+  Serial.println("----- end of log -----");
+  xTaskNotifyGive(serialLogTask);  // Resume live output
+}
+
+// The dump is far larger than the async log ring, so like the LOG replay
+// it owns the UART and is written only as fast as the TX FIFO has room.
+// Recording stays paused until the last line is out.
+void startTraceDump() {
+  if (!traceDumpStart()) {
+    logLine("⚠ Trace dump already in progress");
+    return;
+  }
+  traceDumpStreaming = true;
+  traceDumpLength = 0;
+  serialLogPaused = true;
+}
+
+void consoleStreamTrace() {
+  for (int lines = TRACE_DUMP_LINES_PER_PASS; lines > 0; lines--) {
+    if (traceDumpLength == 0) {
+      if (!traceDumpLine(traceDumpText, sizeof(traceDumpText))) {
+        traceDumpStreaming = false;
+        serialLogPaused = consoleLogActive;
+        xTaskNotifyGive(serialLogTask);  // Resume live output
+        return;
+      }
+      traceDumpLength = strlen(traceDumpText);
+    }
+    if (Serial.availableForWrite() < (int)traceDumpLength + 2) return;
+    Serial.println(traceDumpText);
+    traceDumpLength = 0;
+  }
+}
+
+void consoleStats() {
+  SerialLogStats logStats = serialLogSnapshot();
+  
+  logPrintf("Uptime: %lus", millis() / 1000);
+  logPrintf("Heap: %lu free, %lu min", (unsigned long)ESP.getFreeHeap(),
+            (unsigned long)ESP.getMinFreeHeap());
+  logPrintf("WiFi: %s, RSSI %d dBm", WiFi.status() == WL_CONNECTED ? "connected" : "down",
+            WiFi.RSSI());
+  logPrintf("MQTT: %s (state %d)", client.connected() ? "connected" : "down", client.state());
+  logPrintf("Publishes: %lu ok, %lu failed; commands: %lu", publishCount, publishFailures,
+            commandCount);
+  logPrintf("Loop stalls (>%lums): %lu", LOOP_STALL_MS, loopStalls);
+  logPrintf("Soil samples: %lu quiet, %lu forced; last raw %d, spread %u, flags 0x%02x",
+            samplesQuiet, samplesForced, soilSample.raw, soilSample.spread, soilSample.flags);
+  logPrintf("Serial log: %lu lines, %lu dropped (%lu bytes), high water %lu/%d",
+            (unsigned long)logStats.lines, (unsigned long)logStats.droppedLines,
+            (unsigned long)logStats.droppedBytes, (unsigned long)logStats.highWater,
+            SERIAL_LOG_BYTES);
+  logPrintf("Pump: %s", pumpIsOn() ? "ON" : "OFF");
+  if (USE_LATCHING_VALVE) {
+    static const char* const names[] = {"unknown", "closed", "open"};
+    logPrintf("Valve: %s (target %s), %lu pulses, last sense %d%s", names[valveState],
+              names[valveTarget], valvePulses, valvePulseSense, valveFault ? ", FAULT" : "");
+  }
+  logPrintf("Scheduled commands: %u/%u", scheduledCount, MAX_SCHEDULED);
+  if (RELAY_BANK != RELAY_BANK_NONE) {
+    logPrintf("Zones: 0x%08lx on, %lu bank writes, %lu failed%s", (unsigned long)zoneShadow,
+              zoneWrites, zoneWriteErrors, zoneBankDirty ? " (retrying)" : "");
+  }
+  if (USE_SOIL_TEMP) {
+    if (soilTempFresh()) {
+      logPrintf("Soil temp: %.2f°C (%lus old), %lu read errors", soilTempC16 / 16.0,
+                (millis() - soilTempAt) / 1000, tempReadErrors);
+    } else {
+      logPrintf("Soil temp: no reading, %lu read errors", tempReadErrors);
+    }
+  }
+  if (USE_DOSER) {
+    logPrintf("Doser: %s, %lu doses, %.1f steps/ml", doseActive ? "dosing" : "idle", doseCount,
+              stepsPerMl);
+  }
+  if (forecast.valid) {
+    logPrintf("Forecast: %.1f°C, rain %d%%, %lus old", forecast.temperature,
+              forecast.rainProbability, (millis() - forecast.receivedAt) / 1000);
+  } else {
+    logLine("Forecast: none yet");
+  }
+}
+
+void consoleCalibrate(char* which, char* value) {
+  if (which != nullptr) {
+    for (char* p = which; *p; p++) *p = toupper(*p);
+    
+    if (strcmp(which, "RESET") == 0) {
+      airMv = AIR_MV;
+      waterMv = WATER_MV;
+      prefs.remove("air_mv");
+      prefs.remove("water_mv");
+    } else if (strcmp(which, "AIR") == 0 || strcmp(which, "WATER") == 0) {
+      // Without a value, take the current reading
+      int mv = value != nullptr ? atoi(value) : adcMvLut[readSoilBurst(nullptr)];
+      if (strcmp(which, "AIR") == 0) {
+        airMv = mv;
+        prefs.putInt("air_mv", mv);
+      } else {
+        waterMv = mv;
+        prefs.putInt("water_mv", mv);
+      }
+    } else {
+      logLine("Usage: CAL [AIR|WATER [mV]] | CAL RESET");
+      return;
+    }
+  }
+  
+  int raw = readSoilBurst(nullptr);
+  logPrintf("Calibration: air=%dmV water=%dmV (current reading %dmV, raw %d; ADC cal: %s)",
+            airMv, waterMv, adcMvLut[raw], raw, adcCalSource);
+}
+
+void consoleConfig(char* key, char* value) {
+  if (key != nullptr) {
+    for (char* p = key; *p; p++) *p = toupper(*p);
+    
+    if (strcmp(key, "INTERVAL") == 0 && value != nullptr && atoi(value) >= 5) {
+      publishInterval = (unsigned long)atoi(value) * 1000;
+      prefs.putULong("interval", publishInterval);
+    } else {
+      logLine("Usage: CONFIG [INTERVAL seconds]  (minimum 5)");
+      return;
+    }
+  }
+  
+  logPrintf("Device: %s, firmware %s", DEVICE_ID, FIRMWARE_VERSION);
+  logPrintf("WiFi SSID: %s", ssid);
+  logPrintf("MQTT: %s:%d", mqtt_server, mqtt_port);
+  logPrintf("Topics: %s, %s, %s", telemetry_topic, command_topic, forecast_topic);
+  logPrintf("Location: %.4f, %.4f", DEVICE_LATITUDE, DEVICE_LONGITUDE);
+  logPrintf("Publish interval: %lus", publishInterval / 1000);
+  if (USE_LATCHING_VALVE) {
+    logPrintf("Pins: soil GPIO%d, valve open GPIO%d / close GPIO%d, sense GPIO%d",
+              SOIL_SENSOR_PIN, VALVE_OPEN_PIN, VALVE_CLOSE_PIN, VALVE_SENSE_PIN);
+  } else {
+    logPrintf("Pins: soil GPIO%d, pump GPIO%d", SOIL_SENSOR_PIN, PUMP_RELAY_PIN);
+  }
+  if (RELAY_BANK == RELAY_BANK_74HC595) {
+    logPrintf("Relay bank: %u zones on 74HC595 (SER GPIO%d, SRCLK GPIO%d, RCLK GPIO%d, /OE GPIO%d)",
+              ZONE_COUNT, SR_DATA_PIN, SR_CLOCK_PIN, SR_LATCH_PIN, SR_ENABLE_PIN);
+  } else if (RELAY_BANK == RELAY_BANK_MCP23017) {
+    logPrintf("Relay bank: %u zones on MCP23017 at 0x%02x (SDA GPIO%d, SCL GPIO%d)", ZONE_COUNT,
+              EXPANDER_ADDRESS, EXPANDER_SDA_PIN, EXPANDER_SCL_PIN);
+  }
+}
+
+// ============================================
+// Reading History
+// ============================================
+void recordHistory(int soilMoisture, int moisturePercent, bool pumpOn) {
+  HistorySample sample;
+  time_t now = time(nullptr);
+  bool synced = now > 1600000000;  // SNTP has set the clock
+  
+  sample.time = synced ? (uint32_t)now : millis() / 1000;
+  sample.soilMoisture = (uint16_t)soilMoisture;
+  sample.moisturePercent = (uint8_t)moisturePercent;
+  sample.flags = (pumpOn ? HISTORY_PUMP_ON : 0) | (synced ? 0 : HISTORY_TIME_UPTIME);
+  
+  portENTER_CRITICAL(&historyMux);
+  history[historyCount % HISTORY_SAMPLES] = sample;
+  historyCount++;
+  portEXIT_CRITICAL(&historyMux);
+}
+
+// Copy the sample with sequence number *seq, moving *seq forward past
+// samples that have already been overwritten. False if it doesn't exist yet.
+bool readHistory(uint32_t* seq, HistorySample* out) {
+  bool found = false;
+  portENTER_CRITICAL(&historyMux);
+  uint32_t oldest = historyCount > HISTORY_SAMPLES ? historyCount - HISTORY_SAMPLES : 0;
+  if (*seq < oldest) {
+    *seq = oldest;
+  }
+  if (*seq < historyCount) {
+    *out = history[*seq % HISTORY_SAMPLES];
+    found = true;
+  }
+  portEXIT_CRITICAL(&historyMux);
+  return found;
+}
+
+// ============================================
+// Local Web Server
+// ============================================
+// ESPAsyncWebServer handles requests on the AsyncTCP task, so serving
+// never blocks loop(). Handlers only copy state; nothing here touches
+// the ADC or the pump.
+
+void startWebServer() {
+  updateStatusSnapshot();  // Handlers only ever read the snapshot
+  
+  // UI: gzipped page sent straight from flash
+  webServer.on("/", HTTP_GET, [](AsyncWebServerRequest* request) {
+    AsyncWebServerResponse* response =
+        request->beginResponse_P(200, "text/html", STATUS_PAGE_GZ, STATUS_PAGE_GZ_LEN);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Cache-Control", "max-age=86400");
+    request->send(response);
+  });
+  
+  webServer.on("/api/status", HTTP_GET, [](AsyncWebServerRequest* request) {
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    writeStatusJson(*response);
+    request->send(response);
+  });
+  
+  // ?format=bin for packed 8-byte samples, JSON otherwise
+  webServer.on("/api/history", HTTP_GET, [](AsyncWebServerRequest* request) {
+    std::shared_ptr<HistoryStream> stream(new HistoryStream());
+    stream->binary = request->hasParam("format") &&
+                     request->getParam("format")->value() == "bin";
+    portENTER_CRITICAL(&historyMux);
+    stream->end = historyCount;
+    portEXIT_CRITICAL(&historyMux);
+    
+    AsyncWebServerResponse* response = request->beginChunkedResponse(
+        stream->binary ? "application/octet-stream" : "application/json",
+        [stream](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+          return fillHistoryChunk(*stream, buffer, maxLen);
+        });
+    request->send(response);
+  });
+  
+  webServer.onNotFound([](AsyncWebServerRequest* request) {
+    request->send(404, "text/plain", "Not found");
+  });
+  
+  webServer.begin();
+  Serial.println("✓ Status page: http://" + WiFi.localIP().toString() + "/");
+}
+
+// Runs in loop(): the only place /api/status data is gathered
+void updateStatusSnapshot() {
+  StatusSnapshot snapshot = {};
+  HistorySample latest;
+  
+  portENTER_CRITICAL(&historyMux);
+  uint32_t count = historyCount;
+  portEXIT_CRITICAL(&historyMux);
+  uint32_t seq = count > 0 ? count - 1 : 0;
+  
+  snapshot.uptime = millis() / 1000;
+  snapshot.time = (uint32_t)time(nullptr);
+  snapshot.haveSample = readHistory(&seq, &latest);
+  if (snapshot.haveSample) {
+    snapshot.moisturePercent = latest.moisturePercent;
+    snapshot.soilMoisture = latest.soilMoisture;
+  }
+  snapshot.pumpOn = pumpIsOn();
+  snapshot.rssi = WiFi.RSSI();
+  snapshot.mqttConnected = client.connected();
+  snapshot.freeHeap = ESP.getFreeHeap();
+  snapshot.historySamples = min(count, HISTORY_SAMPLES);
+  snapshot.forecastValid = forecast.valid;
+  snapshot.forecastTemperature = forecast.temperature;
+  snapshot.forecastHumidity = forecast.humidity;
+  snapshot.forecastRain = forecast.rainProbability;
+  
+  portENTER_CRITICAL(&statusMux);
+  statusSnapshot = snapshot;
+  portEXIT_CRITICAL(&statusMux);
+}
+
+// Runs on the AsyncTCP task: serializes the latest snapshot only
+void writeStatusJson(Print& out) {
+  portENTER_CRITICAL(&statusMux);
+  StatusSnapshot snapshot = statusSnapshot;
+  portEXIT_CRITICAL(&statusMux);
+  
+  StaticJsonDocument<384> doc;
+  doc["deviceId"] = DEVICE_ID;
+  doc["firmwareVersion"] = FIRMWARE_VERSION;
+  doc["uptime"] = snapshot.uptime;
+  doc["time"] = snapshot.time;
+  if (snapshot.haveSample) {
+    doc["moisturePercent"] = snapshot.moisturePercent;
+    doc["soilMoisture"] = snapshot.soilMoisture;
+  }
+  doc["pumpStatus"] = snapshot.pumpOn ? "ON" : "OFF";
+  doc["rssi"] = snapshot.rssi;
+  doc["mqttConnected"] = snapshot.mqttConnected;
+  doc["freeHeap"] = snapshot.freeHeap;
+  doc["historySamples"] = snapshot.historySamples;
+  if (snapshot.forecastValid) {
+    JsonObject f = doc.createNestedObject("forecast");
+    f["t"] = snapshot.forecastTemperature;
+    f["h"] = snapshot.forecastHumidity;
+    f["r"] = snapshot.forecastRain;
+  }
+  
+  serializeJson(doc, out);
+}
+
+size_t fillHistoryChunk(HistoryStream& stream, uint8_t* buffer, size_t maxLen) {
+  size_t written = 0;
+  
+  while (written < maxLen) {
+    // Finish the sample that didn't fit last time
+    if (stream.pendingOffset < stream.pendingLength) {
+      size_t n = min(maxLen - written, stream.pendingLength - stream.pendingOffset);
+      memcpy(buffer + written, stream.pending + stream.pendingOffset, n);
+      written += n;
+      stream.pendingOffset += n;
+      continue;
+    }
+    if (stream.finished) {
+      break;
+    }
+    
+    HistorySample sample;
+    stream.pendingOffset = 0;
+    stream.pendingLength = 0;
+    
+    if (stream.next < stream.end && readHistory(&stream.next, &sample) &&
+        stream.next < stream.end) {
+      stream.next++;
+      if (stream.binary) {
+        memcpy(stream.pending, &sample, sizeof(sample));
+        stream.pendingLength = sizeof(sample);
+      } else {
+        stream.pendingLength = snprintf(
+            stream.pending, sizeof(stream.pending),
+            "%c{\"t\":%lu,\"raw\":%u,\"pct\":%u,\"flags\":%u}",
+            stream.started ? ',' : '[', (unsigned long)sample.time,
+            sample.soilMoisture, sample.moisturePercent, sample.flags);
+      }
+      stream.started = true;
+    } else {
+      // Returning 0 ends the chunked response, so close the array here
+      stream.finished = true;
+      if (!stream.binary) {
+        stream.pendingLength = snprintf(stream.pending, sizeof(stream.pending), "%s",
+                                        stream.started ? "]" : "[]");
+      }
+    }
+  }
+  
+  return written;
+}
+
+// ============================================
+// HISTORY Backfill
+// ============================================
+// Block format (decoded by history_backfill.py):
+//   first sample as a raw 8-byte HistorySample, then per sample
+//   varint zigzag(dTime) | varint zigzag(dRaw) | varint zigzag(dPercent) << 2 | flags
+// Only samples with wall-clock time are sent (uptime-stamped ones can't
+// be placed in the requested range).
+
+size_t putVarint(uint8_t* out, uint32_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+void startHistoryTransfer(const JsonDocument& doc) {
+  HistoryTransfer& t = historyTransfer;
+  if (t.active) {
+    logPrintf("⚠ HISTORY %lu replaced by a new request", (unsigned long)t.requestId);
+  }
+  
+  t = HistoryTransfer();
+  t.requestId = doc["requestId"] | (uint32_t)random(1, 0x7fffffff);
+  t.from = doc["from"] | 0UL;
+  t.to = doc["to"] | 0xffffffffUL;
+  t.lastAck = millis();
+  t.active = true;
+  
+  // Skip to the first sample in range (history is in time order)
+  HistorySample sample;
+  uint32_t seq = 0;
+  while (readHistory(&seq, &sample) && (sample.time < t.from || (sample.flags & HISTORY_TIME_UPTIME))) {
+    seq++;
+  }
+  t.cursor = seq;
+  
+  logPrintf("📚 HISTORY %lu: %lu..%lu from sample %lu", (unsigned long)t.requestId,
+            (unsigned long)t.from, (unsigned long)t.to, (unsigned long)t.cursor);
+}
+
+void ackHistoryBlock(const JsonDocument& doc) {
+  HistoryTransfer& t = historyTransfer;
+  if (!t.active || (doc["requestId"] | 0UL) != t.requestId) return;
+  
+  // Selective: acks block seq only; the window slides past every block
+  // acknowledged without a gap
+  uint32_t seq = doc["seq"] | 0UL;
+  if (seq < t.ackedBlocks || seq >= t.nextBlock) return;
+  t.ackedMask |= 1UL << (seq - t.ackedBlocks);
+  while (t.ackedMask & 1) {
+    t.ackedMask >>= 1;
+    t.ackedBlocks++;
+  }
+  t.lastAck = millis();
+  t.retries = 0;
+}
+
+bool historyBlockAcked(const HistoryTransfer& t, uint32_t block) {
+  return block < t.ackedBlocks || (t.ackedMask >> (block - t.ackedBlocks)) & 1;
+}
+
+// Encode the block starting at sample *cursor and publish it as block
+// number `block`; re-encoding from the same cursor gives the same block
+bool publishHistoryBlock(uint32_t block, uint32_t* cursor, bool* last) {
+  HistoryTransfer& t = historyTransfer;
+  uint8_t data[HISTORY_BLOCK_BYTES];
+  char encoded[((HISTORY_BLOCK_BYTES + 2) / 3) * 4 + 1];
+  char message[MQTT_BUFFER_SIZE - 64];
+  uint16_t count;
+  size_t base64Length = 0;
+  
+  size_t len = encodeHistoryBlock(cursor, t.to, data, &count, last);
+  mbedtls_base64_encode((unsigned char*)encoded, sizeof(encoded), &base64Length, data, len);
+  encoded[base64Length] = '\0';
+  
+  snprintf(message, sizeof(message),
+           "{\"deviceId\":\"%s\",\"requestId\":%lu,\"seq\":%lu,\"n\":%u,\"last\":%s,\"data\":\"%s\"}",
+           DEVICE_ID, (unsigned long)t.requestId, (unsigned long)block, count,
+           *last ? "true" : "false", encoded);
+  
+  t.lastSend = millis();
+  bool sent = client.publish(history_topic, message);
+  lastRadioTx = millis();
+  return sent;
+}
+
+// Encode samples from *cursor into out; stops at the block size, the end
+// of the range or the newest sample. Sets *last when nothing is left.
+size_t encodeHistoryBlock(uint32_t* cursor, uint32_t to, uint8_t* out, uint16_t* count, bool* last) {
+  HistorySample sample, previous;
+  size_t len = 0;
+  *count = 0;
+  *last = false;
+  
+  while (true) {
+    uint32_t seq = *cursor;
+    if (!readHistory(&seq, &sample) || sample.time > to) {
+      *last = true;
+      break;
+    }
+    if (sample.flags & HISTORY_TIME_UPTIME) {
+      *cursor = seq + 1;
+      continue;
+    }
+    
+    uint8_t encoded[16];
+    size_t n;
+    if (*count == 0) {
+      memcpy(encoded, &sample, sizeof(sample));
+      n = sizeof(sample);
+    } else {
+      n = putVarint(encoded, zigzag((int32_t)(sample.time - previous.time)));
+      n += putVarint(encoded + n, zigzag((int32_t)sample.soilMoisture - previous.soilMoisture));
+      n += putVarint(encoded + n, (zigzag((int32_t)sample.moisturePercent - previous.moisturePercent) << 2) |
+                                      (sample.flags & 0x03));
+    }
+    if (len + n > HISTORY_BLOCK_BYTES) break;
+    
+    memcpy(out + len, encoded, n);
+    len += n;
+    previous = sample;
+    (*count)++;
+    *cursor = seq + 1;
+  }
+  
+  return len;
+}
+
+void historyPump() {
+  HistoryTransfer& t = historyTransfer;
+  if (!t.active || !client.connected()) return;
+  unsigned long now = millis();
+  
+  if (t.ackedBlocks < t.nextBlock && now - t.lastAck > HISTORY_ACK_TIMEOUT_MS) {
+    if (++t.retries > HISTORY_MAX_RETRIES) {
+      logPrintf("✗ HISTORY %lu abandoned: no ack", (unsigned long)t.requestId);
+      t.active = false;
+      return;
+    }
+    // Resend just the blocks still unacknowledged, oldest first
+    logPrintf("⚠ HISTORY %lu: ack timeout, resending unacked blocks from %lu",
+              (unsigned long)t.requestId, (unsigned long)t.ackedBlocks);
+    t.resendBlock = t.ackedBlocks;
+    t.lastAck = now;
+  }
+  
+  while (t.resendBlock < t.nextBlock && historyBlockAcked(t, t.resendBlock)) {
+    t.resendBlock++;
+  }
+  bool resend = t.resendBlock < t.nextBlock;
+  
+  if (!resend && t.finished) {
+    if (t.ackedBlocks == t.nextBlock) {
+      logPrintf("✓ HISTORY %lu complete: %lu blocks", (unsigned long)t.requestId,
+                (unsigned long)t.nextBlock);
+      t.active = false;
+    }
+    return;
+  }
+  if (!resend && t.nextBlock - t.ackedBlocks >= HISTORY_WINDOW) return;  // Window full
+  if (now - t.lastSend < HISTORY_SEND_INTERVAL_MS) return;
+  
+  TRACE_SCOPE("historyPump");
+  bool last;
+  
+  if (resend) {
+    uint32_t cursor = t.blockStart[t.resendBlock % HISTORY_WINDOW];
+    if (publishHistoryBlock(t.resendBlock, &cursor, &last)) {
+      t.resendBlock++;
+    }
+    return;
+  }
+  
+  uint32_t start = t.cursor;
+  if (!publishHistoryBlock(t.nextBlock, &t.cursor, &last)) {
+    t.cursor = start;  // Try the same block again next time
+    return;
+  }
+  
+  if (t.nextBlock == t.ackedBlocks) {
+    t.lastAck = now;  // Ack timer starts with the oldest unacked block
+  }
+  t.blockStart[t.nextBlock % HISTORY_WINDOW] = start;
+  t.nextBlock++;
+  t.resendBlock = t.nextBlock;
+  t.finished = last;
+}
+
+// ============================================
+// Scheduled Commands (Timer Wheel)
+// ============================================
+void rebuildTimerWheel() {
+  for (uint8_t slot = 0; slot < WHEEL_SLOTS; slot++) {
+    wheel[slot] = TIMER_NONE;
+  }
+  scheduledFree = TIMER_NONE;
+  scheduledCount = 0;
+  
+  for (int8_t i = MAX_SCHEDULED - 1; i >= 0; i--) {
+    if (scheduled[i].action != 0) {
+      uint8_t slot = scheduled[i].at % WHEEL_SLOTS;
+      scheduled[i].next = wheel[slot];
+      wheel[slot] = i;
+      scheduledCount++;
+    } else {
+      scheduled[i].next = scheduledFree;
+      scheduledFree = i;
+    }
+  }
+}
+
+void loadSchedule() {
+  memset(scheduled, 0, sizeof(scheduled));
+  if (prefs.getBytesLength("schedule") == sizeof(scheduled)) {
+    prefs.getBytes("schedule", scheduled, sizeof(scheduled));
+  }
+  rebuildTimerWheel();
+  Serial.println("✓ Scheduled commands restored: " + String(scheduledCount));
+}
+
+void saveSchedule() {
+  prefs.putBytes("schedule", scheduled, sizeof(scheduled));
+}
+
+void scheduleCommand(const JsonDocument& doc) {
+  if (scheduledFree == TIMER_NONE) {
+    logLine("✗ Schedule full - command dropped");
+    return;
+  }
+  
+  int8_t i = scheduledFree;
+  ScheduledCommand& entry = scheduled[i];
+  scheduledFree = entry.next;
+  
+  entry.at = doc["at"];
+  entry.id = doc["scheduleId"] | (uint32_t)random(1, 0x7fffffff);
+  entry.zones = commandZones(doc);
+  entry.duration = doc["duration"] | 0;
+  entry.doseMl10 = (uint16_t)lroundf((doc["doseMl"] | 0.0f) * 10);
+  entry.traceId = doc["traceId"] | 0ULL;
+  entry.action = strcmp(doc["action"], "WATER_ON") == 0 ? SCHEDULED_WATER_ON : SCHEDULED_WATER_OFF;
+  
+  uint8_t slot = entry.at % WHEEL_SLOTS;
+  entry.next = wheel[slot];
+  wheel[slot] = i;
+  scheduledCount++;
+  saveSchedule();
+  
+  logPrintf("⏰ Scheduled %s at %lu (id %lu, in %lds)",
+            entry.action == SCHEDULED_WATER_ON ? "WATER_ON" : "WATER_OFF",
+            (unsigned long)entry.at, (unsigned long)entry.id,
+            (long)(entry.at - (uint32_t)time(nullptr)));
+}
+
+// id 0 cancels everything
+void cancelScheduled(uint32_t id) {
+  uint8_t cancelled = 0;
+  for (uint8_t i = 0; i < MAX_SCHEDULED; i++) {
+    if (scheduled[i].action != 0 && (id == 0 || scheduled[i].id == id)) {
+      scheduled[i].action = 0;
+      cancelled++;
+    }
+  }
+  if (cancelled > 0) {
+    rebuildTimerWheel();
+    saveSchedule();
+  }
+  logPrintf("⏰ Cancelled %u scheduled command(s)", cancelled);
+}
+
+void listScheduled() {
+  uint32_t now = time(nullptr);
+  logPrintf("Scheduled commands: %u/%u", scheduledCount, MAX_SCHEDULED);
+  for (uint8_t i = 0; i < MAX_SCHEDULED; i++) {
+    const ScheduledCommand& entry = scheduled[i];
+    if (entry.action == 0) continue;
+    logPrintf("  id %lu: %s %us at %lu (in %lds)", (unsigned long)entry.id,
+              entry.action == SCHEDULED_WATER_ON ? "WATER_ON" : "WATER_OFF",
+              entry.duration, (unsigned long)entry.at, (long)(entry.at - now));
+  }
+}
+
+// Fire every due entry in one slot
+void fireTimerSlot(uint8_t slot, uint32_t now) {
+  ScheduledCommand due[MAX_SCHEDULED];
+  uint8_t dueCount = 0;
+  
+  int8_t* link = &wheel[slot];
+  while (*link != TIMER_NONE) {
+    int8_t i = *link;
+    if (scheduled[i].at <= now) {
+      due[dueCount++] = scheduled[i];
+      *link = scheduled[i].next;
+      scheduled[i].action = 0;
+      scheduled[i].next = scheduledFree;
+      scheduledFree = i;
+      scheduledCount--;
+    } else {
+      link = &scheduled[i].next;  // Due in a later lap of the wheel
+    }
+  }
+  if (dueCount == 0) return;
+  
+  // Persist first so a crash while watering can't replay the command
+  saveSchedule();
+  
+  for (uint8_t i = 0; i < dueCount; i++) {
+    if (now - due[i].at > SCHEDULE_MAX_LATE_S) {
+      logPrintf("⚠ Skipping scheduled command %lu: %lus late", (unsigned long)due[i].id,
+                (unsigned long)(now - due[i].at));
+      continue;
+    }
+    
+    StaticJsonDocument<COMMAND_DOC_SIZE> doc;
+    doc["action"] = due[i].action == SCHEDULED_WATER_ON ? "WATER_ON" : "WATER_OFF";
+    if (due[i].duration > 0) {
+      doc["duration"] = due[i].duration;
+    }
+    if (due[i].doseMl10 > 0) {
+      doc["doseMl"] = due[i].doseMl10 / 10.0f;
+    }
+    if (due[i].zones != 0) {
+      JsonArray zones = doc.createNestedArray("zones");
+      for (uint8_t zone = 0; zone < MAX_ZONES; zone++) {
+        if (due[i].zones & (1UL << zone)) zones.add(zone + 1);
+      }
+    }
+    if (due[i].traceId != 0) {
+      doc["traceId"] = due[i].traceId;
+    }
+    logPrintf("⏰ Running scheduled command %lu", (unsigned long)due[i].id);
+    handleCommand(doc);
+  }
+}
+
+void advanceTimerWheel() {
+  uint32_t now = time(nullptr);
+  if (now < 1600000000 || now == wheelTime) return;  // Clock not set yet / same second
+  
+  if (wheelTime == 0 || now < wheelTime || now - wheelTime >= WHEEL_SLOTS) {
+    // First run, clock stepped, or fell a whole lap behind: sweep every slot
+    for (uint8_t slot = 0; slot < WHEEL_SLOTS; slot++) {
+      fireTimerSlot(slot, now);
+    }
+  } else {
+    while (wheelTime != now) {
+      wheelTime++;
+      fireTimerSlot(wheelTime % WHEEL_SLOTS, now);
+    }
+  }
+  wheelTime = now;
+}
+
+// ============================================
+// Pump / Valve Output
+// ============================================
+void setPump(bool on) {
+  if (USE_LATCHING_VALVE) {
+    setValve(on);
+  } else {
+    if (digitalRead(PUMP_RELAY_PIN) != (on ? HIGH : LOW)) {
+      lastActuation = millis();
+    }
+    digitalWrite(PUMP_RELAY_PIN, on ? HIGH : LOW);
+  }
+}
+
+// Commanded state; for the valve, valveState has the verified position
+bool pumpIsOn() {
+  if (USE_LATCHING_VALVE) {
+    return valveTarget == VALVE_OPEN;
+  }
+  return digitalRead(PUMP_RELAY_PIN) == HIGH;
+}
+
+// Runs in the esp_timer task at the end of each pulse. Waits at most one
+// soil burst (well under a millisecond) for the ADC.
+void valvePulseEnd(void* arg) {
+  if (VALVE_SENSE_PIN >= 0) {
+    xSemaphoreTake(adcMutex, portMAX_DELAY);
+    valvePulseSense = analogRead(VALVE_SENSE_PIN);  // Coil is still driven here
+    xSemaphoreGive(adcMutex);
+  }
+  digitalWrite(VALVE_OPEN_PIN, LOW);
+  digitalWrite(VALVE_CLOSE_PIN, LOW);
+  valvePulseActive = false;
+  valvePulseDone = true;
+}
+
+void valveBegin() {
+  pinMode(VALVE_OPEN_PIN, OUTPUT);
+  pinMode(VALVE_CLOSE_PIN, OUTPUT);
+  digitalWrite(VALVE_OPEN_PIN, LOW);
+  digitalWrite(VALVE_CLOSE_PIN, LOW);
+  if (VALVE_SENSE_PIN >= 0) {
+    pinMode(VALVE_SENSE_PIN, INPUT);
+  }
+  
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = valvePulseEnd;
+  timerArgs.name = "valvePulse";
+  esp_timer_create(&timerArgs, &valvePulseTimer);
+  
+  setValve(false);
+}
+
+void startValvePulse() {
+  valvePulsing = valveTarget;
+  valveAttempts++;
+  valvePulses++;
+  valvePulseActive = true;
+  lastActuation = millis();
+  
+  // One side of the bridge only; the other input stays LOW
+  digitalWrite(valvePulsing == VALVE_OPEN ? VALVE_OPEN_PIN : VALVE_CLOSE_PIN, HIGH);
+  esp_timer_start_once(valvePulseTimer, VALVE_PULSE_US);
+  TRACE_INSTANT(valvePulsing == VALVE_OPEN ? "valve.open" : "valve.close");
+}
+
+void setValve(bool open) {
+  valveTarget = open ? VALVE_OPEN : VALVE_CLOSED;
+  valveAttempts = 0;
+  // A pulse in flight finishes first; valvePoll() then pulses again if needed
+  if (!valvePulseActive && !valvePulseDone) {
+    startValvePulse();
+  }
+}
+
+void valvePoll() {
+  if (!valvePulseDone) return;
+  valvePulseDone = false;
+  
+  const char* direction = valvePulsing == VALVE_OPEN ? "open" : "close";
+  bool driven = VALVE_SENSE_PIN < 0 || valvePulseSense >= VALVE_SENSE_MIN;
+  
+  if (driven) {
+    valveState = valvePulsing;
+    valveFault = false;
+  } else {
+    valveState = VALVE_UNKNOWN;
+    if (valvePulsing == valveTarget && valveAttempts < VALVE_MAX_ATTEMPTS) {
+      logPrintf("⚠ Valve %s pulse not confirmed (sense %d), retrying", direction, valvePulseSense);
+      startValvePulse();
+      return;
+    }
+    valveFault = true;
+    logPrintf("✗ Valve %s failed (sense %d) - check coil wiring and supply", direction,
+              valvePulseSense);
+  }
+  
+  // Target changed while the pulse was in flight
+  if (valveTarget != valvePulsing) {
+    valveAttempts = 0;
+    startValvePulse();
+  }
+}
+
+// ============================================
+// Zone Relay Bank
+// ============================================
+void relayBankBegin() {
+  if (RELAY_BANK == RELAY_BANK_74HC595) {
+    // /OE keeps the outputs off until the registers hold a known state
+    pinMode(SR_ENABLE_PIN, OUTPUT);
+    digitalWrite(SR_ENABLE_PIN, HIGH);
+    pinMode(SR_LATCH_PIN, OUTPUT);
+    digitalWrite(SR_LATCH_PIN, LOW);
+    SPI.begin(SR_CLOCK_PIN, -1, SR_DATA_PIN, -1);
+  } else {
+    Wire.begin(EXPANDER_SDA_PIN, EXPANDER_SCL_PIN, 400000);
+  }
+  
+  // Outputs are enabled by the first write that succeeds; if that isn't
+  // this one, zonePoll() keeps retrying until it is
+  zoneShadow = 0;
+  zoneBankReady = false;
+  zoneBankDirty = true;
+  commitZones();
+  if (zoneBankReady) {
+    Serial.println("✓ Relay bank ready: " + String(ZONE_COUNT) + " zones");
+  }
+}
+
+// Switch the bank's outputs on once its latches hold a known state
+bool enableRelayBank() {
+  if (RELAY_BANK == RELAY_BANK_74HC595) {
+    digitalWrite(SR_ENABLE_PIN, LOW);
+    return true;
+  }
+  Wire.beginTransmission(EXPANDER_ADDRESS);
+  Wire.write(0x00);  // IODIRA, auto-increments to IODIRB
+  Wire.write(0x00);
+  Wire.write(0x00);
+  return Wire.endTransmission() == 0;
+}
+
+// Write a full zone mask to the bank in one transfer
+bool writeRelayBank(uint32_t mask) {
+  uint32_t levels = RELAY_BANK_ACTIVE_LOW ? ~mask : mask;
+  bool ok = true;
+  TRACE_BEGIN("zones.write");
+  
+  if (RELAY_BANK == RELAY_BANK_74HC595) {
+    // Last byte shifted ends up in the first register of the chain
+    uint8_t bytes[MAX_ZONES / 8];
+    uint8_t count = (ZONE_COUNT + 7) / 8;
+    for (uint8_t i = 0; i < count; i++) {
+      bytes[i] = (levels >> (8 * (count - 1 - i))) & 0xff;
+    }
+    SPI.beginTransaction(SPISettings(10000000, MSBFIRST, SPI_MODE0));
+    SPI.writeBytes(bytes, count);
+    SPI.endTransaction();
+    // Outputs only change on the RCLK edge, all at once
+    digitalWrite(SR_LATCH_PIN, HIGH);
+    digitalWrite(SR_LATCH_PIN, LOW);
+  } else {
+    Wire.beginTransmission(EXPANDER_ADDRESS);
+    Wire.write(0x14);  // OLATA, auto-increments to OLATB
+    Wire.write(levels & 0xff);
+    Wire.write((levels >> 8) & 0xff);
+    ok = Wire.endTransmission() == 0;
+  }
+  if (ok && !zoneBankReady) {
+    ok = zoneBankReady = enableRelayBank();
+  }
+  
+  TRACE_END("zones.write");
+  lastActuation = millis();
+  zoneWrites++;
+  if (ok) {
+    zoneLatched = mask;
+  } else {
+    zoneWriteErrors++;
+  }
+  return ok;
+}
+
+// Push the shadow register to the bank if anything changed
+void commitZones() {
+  if (zoneShadow == zoneLatched && !zoneBankDirty) return;
+  
+  zoneBankDirty = !writeRelayBank(zoneShadow);
+  if (zoneBankDirty) {
+    zoneRetryAt = millis() + 1000;
+    logPrintf("✗ Relay bank write failed (zones 0x%08lx), retrying", (unsigned long)zoneShadow);
+  }
+}
+
+// Zone mask from "zone": n or "zones": [n, ...] (1-based); 0 if neither
+uint32_t commandZones(const JsonDocument& doc) {
+  uint32_t mask = 0;
+  if (RELAY_BANK == RELAY_BANK_NONE) return 0;
+  
+  if (doc.containsKey("zone")) {
+    int zone = doc["zone"];
+    if (zone >= 1 && zone <= ZONE_COUNT) mask |= 1UL << (zone - 1);
+  }
+  JsonArray zones = doc["zones"];
+  for (JsonVariant zone : zones) {
+    int n = zone.as<int>();
+    if (n >= 1 && n <= ZONE_COUNT) mask |= 1UL << (n - 1);
+  }
+  return mask;
+}
+
+void waterZones(uint32_t zones, int duration) {
+  unsigned long now = millis();
+  zoneShadow |= zones;
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    if (!(zones & (1UL << zone))) continue;
+    if (duration > 0) {
+      zoneOffAt[zone] = now + (unsigned long)duration * 1000;
+      zoneTimed |= 1UL << zone;
+    } else {
+      zoneTimed &= ~(1UL << zone);
+    }
+  }
+  commitZones();
+  TRACE_INSTANT("zones.on");
+  logPrintf("💧 Zones ON: 0x%08lx%s", (unsigned long)zones, duration > 0 ? "" : " (until WATER_OFF)");
+  if (duration > 0) {
+    logPrintf("   Duration: %d seconds", duration);
+  }
+}
+
+void stopZones(uint32_t zones) {
+  zoneShadow &= ~zones;
+  zoneTimed &= ~zones;
+  commitZones();
+  TRACE_INSTANT("zones.off");
+  logPrintf("🛑 Zones OFF: 0x%08lx", (unsigned long)zones);
+}
+
+// Expire zone deadlines (all zones due this pass switch in one write)
+void zonePoll() {
+  unsigned long now = millis();
+  uint32_t expired = 0;
+  
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    if ((zoneTimed & (1UL << zone)) && (long)(now - zoneOffAt[zone]) >= 0) {
+      expired |= 1UL << zone;
+    }
+  }
+  if (expired != 0) {
+    stopZones(expired);
+    publishSensorData();  // Ack: report the zones stopped
+  } else if (zoneBankDirty && (long)(now - zoneRetryAt) >= 0) {
+    commitZones();
+  }
+}
+
+// ============================================
+// Nutrient Dosing
+// ============================================
+bool wateringActive() {
+  return pumpIsOn() || zoneShadow != 0;
+}
+
+// Keep whatever is watering running for at least another ms
+void holdWatering(unsigned long ms) {
+  unsigned long until = millis() + ms;
+  if (pumpTimerActive && (long)(until - pumpOffAt) > 0) {
+    pumpOffAt = until;
+  }
+  for (uint8_t zone = 0; zone < ZONE_COUNT; zone++) {
+    if ((zoneTimed & (1UL << zone)) && (long)(until - zoneOffAt[zone]) > 0) {
+      zoneOffAt[zone] = until;
+    }
+  }
+}
+
+// RMT interrupt: the last batch is out, wake the dose task for the next
+void IRAM_ATTR doseTxEnd(rmt_channel_t channel, void* arg) {
+  if (channel != DOSER_RMT_CHANNEL || doseTask == nullptr) return;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(doseTask, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+void doseTaskLoop(void* unused) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    
+    portENTER_CRITICAL(&doseMux);
+    uint32_t batch = doseStopRequested ? 0 : min(doseRemaining, (uint32_t)DOSE_BATCH_STEPS);
+    doseRemaining -= batch;
+    doseSent += batch;
+    if (batch == 0 && doseActive) {
+      doseActive = false;
+      doseFinished = true;
+    }
+    portEXIT_CRITICAL(&doseMux);
+    
+    if (batch > 0) {
+      rmt_write_items(DOSER_RMT_CHANNEL, doseItems, batch, false);
+    }
+  }
+}
+
+void doseBegin() {
+  pinMode(DOSER_ENABLE_PIN, OUTPUT);
+  digitalWrite(DOSER_ENABLE_PIN, HIGH);  // Driver off between doses
+  
+  rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)DOSER_STEP_PIN, DOSER_RMT_CHANNEL);
+  config.clk_div = 80;  // 1 µs ticks
+  rmt_config(&config);
+  rmt_driver_install(DOSER_RMT_CHANNEL, 0, 0);
+  rmt_register_tx_end_callback(doseTxEnd, nullptr);
+  
+  // Every step is the same pulse, so one batch buffer serves every dose
+  for (uint16_t i = 0; i < DOSE_BATCH_STEPS; i++) {
+    doseItems[i].level0 = 1;
+    doseItems[i].duration0 = DOSER_PULSE_US;
+    doseItems[i].level1 = 0;
+    doseItems[i].duration1 = 1000000 / DOSER_STEP_HZ - DOSER_PULSE_US;
+  }
+  
+  xTaskCreatePinnedToCore(doseTaskLoop, "dose", 2048, nullptr, 5, &doseTask, 1);
+  Serial.println("✓ Doser ready: " + String(stepsPerMl, 1) + " steps/ml");
+}
+
+bool startDose(float ml) {
+  if (!USE_DOSER) {
+    logLine("✗ No doser configured");
+    return false;
+  }
+  if (ml <= 0 || ml > DOSE_MAX_ML) {
+    logPrintf("✗ Dose must be 0-%.0f ml", DOSE_MAX_ML);
+    return false;
+  }
+  if (doseActive || doseFinished) {
+    logLine("✗ Dose already running");
+    return false;
+  }
+  
+  uint32_t steps = (uint32_t)lroundf(ml * stepsPerMl);
+  unsigned long runMs = (unsigned long)((uint64_t)steps * 1000 / DOSER_STEP_HZ);
+  
+  // Never dose into a dry line: nutrients go in with water flowing and
+  // the line is flushed afterwards
+  if (!wateringActive()) {
+    StaticJsonDocument<128> doc;
+    doc["action"] = "WATER_ON";
+    doc["duration"] = (runMs + DOSE_FLUSH_MS) / 1000 + 1;
+    handleCommand(doc);
+  } else {
+    holdWatering(runMs + DOSE_FLUSH_MS);
+  }
+  
+  portENTER_CRITICAL(&doseMux);
+  doseRemaining = steps;
+  doseSent = 0;
+  doseStopRequested = false;
+  doseActive = true;
+  portEXIT_CRITICAL(&doseMux);
+  doseTotal = steps;
+  
+  digitalWrite(DOSER_ENABLE_PIN, LOW);
+  lastActuation = millis();
+  TRACE_INSTANT("dose.start");
+  xTaskNotifyGive(doseTask);
+  logPrintf("🧪 Dosing %.1f ml (%lu steps, ~%lus)", ml, (unsigned long)steps, runMs / 1000);
+  return true;
+}
+
+// The batch already in the RMT completes, then the dose ends
+void stopDose(const char* reason) {
+  if (!doseActive) return;
+  doseStopRequested = true;
+  logPrintf("🧪 Stopping dose: %s", reason);
+}
+
+void dosePoll() {
+  if (doseActive && !wateringActive()) {
+    stopDose("watering stopped");
+  }
+  if (!doseFinished) return;
+  
+  doseFinished = false;
+  digitalWrite(DOSER_ENABLE_PIN, HIGH);
+  lastActuation = millis();
+  TRACE_INSTANT("dose.end");
+  lastDoseSteps = doseSent;
+  doseCount++;
+  logPrintf("🧪 Dose done: %.2f ml (%lu/%lu steps)", doseSent / stepsPerMl,
+            (unsigned long)doseSent, (unsigned long)doseTotal);
+}
+
+void consoleDose(char* arg, char* value) {
+  if (arg == nullptr) {
+    logLine("Usage: DOSE ml | DOSE STOP | DOSE CAL measured_ml");
+    return;
+  }
+  for (char* p = arg; *p; p++) *p = toupper(*p);
+  
+  if (strcmp(arg, "STOP") == 0) {
+    stopDose("console");
+  } else if (strcmp(arg, "CAL") == 0) {
+    // Dose a nominal amount, measure what came out, then enter it here
+    float measured = value != nullptr ? atof(value) : 0;
+    if (lastDoseSteps == 0 || measured <= 0) {
+      logLine("Usage: run DOSE <ml>, measure the output, then DOSE CAL <measured ml>");
+      return;
+    }
+    stepsPerMl = lastDoseSteps / measured;
+    prefs.putFloat("steps_ml", stepsPerMl);
+    logPrintf("Doser calibration: %.1f steps/ml", stepsPerMl);
+  } else {
+    StaticJsonDocument<128> doc;
+    doc["action"] = "DOSE";
+    doc["ml"] = atof(arg);
+    handleCommand(doc);
+  }
+}
+
+// ============================================
+// Soil Sampling
+// ============================================
+// Median of a back-to-back ADC burst (well under a millisecond)
+int readSoilBurst(uint16_t* spread) {
+  int readings[SAMPLE_BURST];
+  
+  TRACE_BEGIN("adc.burst");
+  xSemaphoreTake(adcMutex, portMAX_DELAY);
+  for (uint8_t i = 0; i < SAMPLE_BURST; i++) {
+    readings[i] = analogRead(SOIL_SENSOR_PIN);
+  }
+  xSemaphoreGive(adcMutex);
+  TRACE_END("adc.burst");
+  
+  // Insertion sort: 9 elements
+  for (uint8_t i = 1; i < SAMPLE_BURST; i++) {
+    int value = readings[i];
+    int8_t j = i - 1;
+    while (j >= 0 && readings[j] > value) {
+      readings[j + 1] = readings[j];
+      j--;
+    }
+    readings[j + 1] = value;
+  }
+  
+  if (spread != nullptr) {
+    *spread = readings[SAMPLE_BURST - 1] - readings[0];
+  }
+  return readings[SAMPLE_BURST / 2];
+}
+
+void takeSoilSample(uint8_t flags) {
+  uint16_t spread;
+  int raw = readSoilBurst(&spread);
+  
+  if (wateringActive()) flags |= SAMPLE_PUMP_ON;
+  if (doseActive) flags |= SAMPLE_DOSING;
+  if (spread > SAMPLE_SPREAD_MAX) flags |= SAMPLE_SPREAD;
+  
+  soilSample.valid = true;
+  soilSample.raw = raw;
+  // Median of raw == raw of the median: the LUT is monotonic
+  soilSample.mv = compensateSoilMv(adcMvLut[raw]);
+  soilSample.spread = spread;
+  soilSample.flags = flags;
+  soilSample.takenAt = millis();
+  
+  if (flags & SAMPLE_FORCED) {
+    samplesForced++;
+  } else {
+    samplesQuiet++;
+  }
+}
+
+// Take the next sample once the ADC's surroundings are quiet, or at the
+// deferral deadline. The cadence is fixed, so deferral costs no samples.
+void samplerPoll() {
+  unsigned long now = millis();
+  if ((long)(now - nextSampleAt) < 0) return;
+  
+  bool quiet = now - lastRadioTx >= RADIO_QUIET_MS &&
+               now - lastActuation >= ACTUATION_SETTLE_MS &&
+               !valvePulseActive;
+  bool overdue = now - nextSampleAt >= SAMPLE_MAX_DEFER_MS;
+  if (!quiet && !overdue) return;
+  
+  takeSoilSample(quiet ? 0 : SAMPLE_FORCED);
+  
+  nextSampleAt += SAMPLE_INTERVAL_MS;
+  if ((long)(now - nextSampleAt) >= 0) {
+    nextSampleAt = now + SAMPLE_INTERVAL_MS;  // Fell behind (e.g. reconnect); don't burst to catch up
+  }
+}
+
+// ============================================
+// ADC Calibration
+// ============================================
+// Characterize ADC1 from this chip's eFuse calibration (two-point if
+// burned, else the measured Vref) and precompute raw -> mV for every
+// code, so each sample costs one table lookup instead of the
+// curve-fitting in esp_adc_cal_raw_to_voltage().
+void adcBegin() {
+  adcMutex = xSemaphoreCreateMutex();
+  analogReadResolution(12);
+  analogSetPinAttenuation(SOIL_SENSOR_PIN, ADC_11db);  // Full 0-3.1V range; must match below
+  
+  esp_adc_cal_characteristics_t characteristics;
+  esp_adc_cal_value_t source = esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11,
+                                                        ADC_WIDTH_BIT_12, ADC_DEFAULT_VREF_MV,
+                                                        &characteristics);
+  adcCalSource = source == ESP_ADC_CAL_VAL_EFUSE_TP ? "eFuse two-point"
+               : source == ESP_ADC_CAL_VAL_EFUSE_VREF ? "eFuse Vref"
+               : "default Vref (uncalibrated chip)";
+  
+  for (uint16_t raw = 0; raw <= ADC_MAX_RAW; raw++) {
+    adcMvLut[raw] = esp_adc_cal_raw_to_voltage(raw, &characteristics);
+  }
+  
+  Serial.println("✓ ADC characterized: " + String(adcCalSource) + ", full scale " +
+                 String(adcMvLut[ADC_MAX_RAW]) + "mV");
+}
+
+// Calibrated moisture from the sensor voltage (integer math)
+int moisturePercentFromMv(int mv) {
+  if (airMv == waterMv) return 0;
+  int percent = (int32_t)(airMv - mv) * 100 / (airMv - waterMv);
+  return constrain(percent, 0, 100);
+}
+
+// ============================================
+// Soil Temperature Compensation
+// ============================================
+bool soilTempFresh() {
+  return USE_SOIL_TEMP && soilTempValid && millis() - soilTempAt < TEMP_MAX_AGE_MS;
+}
+
+// Compensated sensor voltage; unchanged without a recent temperature
+int compensateSoilMv(int mv) {
+  if (!soilTempFresh()) return mv;
+  
+  int32_t dT = soilTempC16 - TEMP_REF_C16;                      // 1/16 °C
+  int64_t driftUv = (int64_t)tempCoefA * dT / 16 +
+                    (int64_t)tempCoefB * dT * dT / 256;
+  return mv - (int)(driftUv / 1000);
+}
+
+// Non-blocking DS18B20 read: start a conversion, come back when it's
+// done. Single sensor on the bus, so ROM addressing is skipped.
+void tempPoll() {
+  unsigned long now = millis();
+  
+  if (!tempConverting) {
+    if ((long)(now - nextTempAt) < 0) return;
+    nextTempAt = now + TEMP_INTERVAL_MS;
+    if (!oneWire.reset()) {
+      tempReadErrors++;  // No presence pulse
+      return;
+    }
+    oneWire.skip();
+    oneWire.write(0x44);  // CONVERT T
+    tempConverting = true;
+    tempRequestedAt = now;
+    return;
+  }
+  
+  if (now - tempRequestedAt < TEMP_CONVERSION_MS) return;
+  tempConverting = false;
+  
+  uint8_t scratchpad[9];
+  if (!oneWire.reset()) {
+    tempReadErrors++;
+    return;
+  }
+  oneWire.skip();
+  oneWire.write(0xBE);  // READ SCRATCHPAD
+  for (uint8_t i = 0; i < sizeof(scratchpad); i++) {
+    scratchpad[i] = oneWire.read();
+  }
+  if (OneWire::crc8(scratchpad, 8) != scratchpad[8]) {
+    tempReadErrors++;
+    return;
+  }
+  
+  int16_t raw = (int16_t)((scratchpad[1] << 8) | scratchpad[0]);  // 1/16 °C
+  if (raw == 85 * 16) {
+    tempReadErrors++;  // Power-on value: the conversion didn't run
+    return;
+  }
+  soilTempC16 = raw;
+  soilTempAt = now;
+  soilTempValid = true;
+  TRACE_COUNTER("soilTempC16", raw);
+}
+
+void consoleTempComp(char* a, char* b) {
+  if (a != nullptr) {
+    tempCoefA = atoi(a);
+    tempCoefB = b != nullptr ? atoi(b) : 0;
+    prefs.putInt("tc_a", tempCoefA);
+    prefs.putInt("tc_b", tempCoefB);
+  }
+  
+  logPrintf("Temperature compensation: a=%ld µV/°C, b=%ld µV/°C² (reference %d°C)",
+            (long)tempCoefA, (long)tempCoefB, TEMP_REF_C16 / 16);
+  if (soilTempFresh()) {
+    int mv = adcMvLut[readSoilBurst(nullptr)];
+    logPrintf("Now: %.2f°C, %dmV -> %dmV", soilTempC16 / 16.0, mv, compensateSoilMv(mv));
+  } else {
+    logLine("Now: no soil temperature reading (compensation off)");
+  }
+}
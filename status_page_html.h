@@ -0,0 +1,103 @@
+// Generated by embed_web_assets.py from status_page.html - do not edit
+
+#ifndef STATUS_PAGE_HTML_H
+#define STATUS_PAGE_HTML_H
+
+#include <Arduino.h>
+
+const uint8_t STATUS_PAGE_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8d, 0x56, 0x6b, 0x6e, 0xdc, 0x36,
+  0x10, 0xfe, 0xbf, 0xa7, 0x98, 0x28, 0x49, 0x25, 0x25, 0xd6, 0xee, 0x6a, 0xdd, 0xd8, 0xc6, 0xbe,
+  0x0c, 0x38, 0x8f, 0x26, 0x40, 0x83, 0xba, 0xb5, 0x9b, 0xa2, 0x08, 0x02, 0x98, 0x2b, 0x51, 0xbb,
+  0x6c, 0x24, 0x4a, 0x25, 0x29, 0xef, 0x6e, 0xdd, 0x05, 0x7a, 0x80, 0xfe, 0xeb, 0x01, 0x7a, 0x85,
+  0xf6, 0x57, 0xff, 0xe7, 0x28, 0x3d, 0x41, 0x8f, 0xd0, 0x19, 0x52, 0xf2, 0xfa, 0x09, 0x04, 0x7e,
+  0x50, 0x1c, 0xce, 0x7c, 0xf3, 0x1e, 0x72, 0xfc, 0xe0, 0xc5, 0x37, 0xcf, 0x4f, 0x7f, 0x3c, 0x7e,
+  0x09, 0x0b, 0x53, 0xe4, 0xd3, 0xce, 0x98, 0x16, 0xc8, 0x99, 0x9c, 0x4f, 0x3c, 0x2e, 0x3d, 0x22,
+  0x70, 0x96, 0xe2, 0x52, 0x70, 0xc3, 0x20, 0x59, 0x30, 0xa5, 0xb9, 0x99, 0x78, 0xb5, 0xc9, 0xa2,
+  0x03, 0xaf, 0x25, 0x4b, 0x56, 0xf0, 0x89, 0x77, 0x2e, 0xf8, 0xb2, 0x2a, 0x95, 0xf1, 0x20, 0x29,
+  0xa5, 0xe1, 0x12, 0xd9, 0x96, 0x22, 0x35, 0x8b, 0x49, 0xca, 0xcf, 0x45, 0xc2, 0x23, 0xbb, 0xd9,
+  0x01, 0x21, 0x85, 0x11, 0x2c, 0x8f, 0x74, 0xc2, 0x72, 0x3e, 0x89, 0x09, 0xc4, 0x08, 0x93, 0xf3,
+  0xe9, 0x49, 0xc1, 0x94, 0x81, 0xaf, 0x98, 0x4a, 0xb9, 0x1c, 0xf7, 0x1c, 0xad, 0x33, 0xd6, 0x66,
+  0x4d, 0x2b, 0xc0, 0xac, 0x4c, 0xd7, 0x70, 0x01, 0x19, 0x62, 0x47, 0x19, 0x2b, 0x44, 0xbe, 0x1e,
+  0x82, 0x5e, 0x6b, 0xc3, 0x8b, 0xa8, 0x16, 0x3b, 0xa0, 0x99, 0xd4, 0x91, 0xe6, 0x4a, 0x64, 0x23,
+  0x40, 0xa0, 0xb9, 0x90, 0x43, 0xe8, 0x8f, 0x60, 0xc6, 0x92, 0x8f, 0x73, 0x55, 0xd6, 0x32, 0x1d,
+  0xc2, 0xc3, 0x6c, 0x37, 0xdb, 0xcf, 0xe2, 0x11, 0xda, 0x97, 0x97, 0x0a, 0xf7, 0x83, 0xc1, 0xee,
+  0x08, 0x36, 0x88, 0x4d, 0x3e, 0x72, 0x85, 0xe8, 0xd7, 0xd8, 0x07, 0x7c, 0x3f, 0xdd, 0x1d, 0x6c,
+  0xd9, 0xb3, 0x0c, 0xb1, 0x2b, 0x96, 0xa6, 0x42, 0xce, 0x87, 0x10, 0x0f, 0xaa, 0x15, 0xc4, 0x7b,
+  0xd5, 0xea, 0x1a, 0xc4, 0x22, 0x46, 0x94, 0x2b, 0xfa, 0xad, 0xb9, 0x5a, 0xfc, 0xc2, 0x51, 0xa0,
+  0x3b, 0xe0, 0x85, 0x63, 0x2e, 0x98, 0x90, 0xc8, 0xb7, 0xc5, 0xb2, 0x30, 0x05, 0x5b, 0xb9, 0x20,
+  0x0d, 0x61, 0x7f, 0xd0, 0x77, 0x14, 0x07, 0xc4, 0x6a, 0x53, 0x3a, 0xc9, 0x6e, 0x82, 0xf1, 0xd1,
+  0x28, 0x9b, 0x0a, 0x5d, 0xe5, 0x0c, 0x63, 0x30, 0x57, 0x22, 0x1d, 0xd9, 0xff, 0x11, 0xc6, 0x02,
+  0x69, 0x86, 0x47, 0x68, 0x71, 0x5d, 0x48, 0x3d, 0x04, 0xc5, 0x2b, 0xce, 0x4c, 0x40, 0xf2, 0x51,
+  0x26, 0xcc, 0x0e, 0x14, 0x42, 0xa2, 0x9a, 0x20, 0x7e, 0x86, 0xf8, 0x3b, 0x10, 0x67, 0x2a, 0x0c,
+  0x51, 0x98, 0x55, 0x68, 0x43, 0xbf, 0x75, 0xc5, 0xea, 0xb8, 0x19, 0x0c, 0xeb, 0xfc, 0xac, 0xc4,
+  0xe4, 0xa8, 0x48, 0xb1, 0x54, 0xd4, 0x88, 0x7e, 0x40, 0x12, 0xd7, 0x02, 0x42, 0x2c, 0xab, 0x48,
+  0x2f, 0x58, 0x5a, 0x2e, 0xd1, 0x7f, 0x88, 0x31, 0x46, 0xbb, 0xf8, 0xf7, 0xb0, 0xdf, 0xef, 0x0f,
+  0xae, 0xa2, 0xcf, 0xae, 0xba, 0x30, 0xcb, 0xcb, 0xe4, 0xe3, 0x8d, 0x58, 0xed, 0x51, 0xac, 0x9c,
+  0xff, 0x91, 0x29, 0xd1, 0xbe, 0x2f, 0x5b, 0xf3, 0x12, 0x26, 0xcf, 0x19, 0x85, 0xa0, 0x89, 0x55,
+  0xdc, 0xef, 0x3f, 0x1e, 0x61, 0xfc, 0xc5, 0x7c, 0x61, 0x70, 0x77, 0x60, 0xfd, 0xf8, 0x3c, 0xdb,
+  0xaf, 0xe2, 0xc7, 0x97, 0x0a, 0x74, 0xc1, 0xf2, 0x1c, 0xf1, 0xdb, 0xbc, 0xef, 0xed, 0xed, 0xd3,
+  0xc1, 0xb8, 0xd7, 0xd4, 0xe2, 0xb8, 0xd7, 0xf4, 0x04, 0x95, 0x64, 0xd3, 0x21, 0x5c, 0x4d, 0xc7,
+  0x8b, 0x78, 0xfa, 0xdf, 0x9f, 0xbf, 0xff, 0x0d, 0x57, 0x0b, 0x19, 0xc6, 0xba, 0x62, 0x12, 0x44,
+  0x3a, 0xf1, 0x5c, 0x1b, 0x78, 0x53, 0xc4, 0x41, 0x12, 0x2e, 0xc8, 0xef, 0xa0, 0x50, 0x18, 0x3b,
+  0x09, 0x6b, 0x82, 0xea, 0x7c, 0x9c, 0x8a, 0x73, 0x48, 0x72, 0xa6, 0xf5, 0xc4, 0xb3, 0xc9, 0xf6,
+  0x88, 0x7a, 0x9b, 0xee, 0x4d, 0xdf, 0x96, 0x42, 0x9b, 0x5a, 0xf1, 0xf1, 0xcc, 0xe2, 0x17, 0xcd,
+  0xd6, 0x9b, 0xfe, 0xfb, 0xdb, 0x1f, 0xe3, 0xde, 0x0c, 0xc1, 0x51, 0xe4, 0x3e, 0xe1, 0xe3, 0xba,
+  0xa8, 0x1a, 0xc1, 0x0a, 0x3f, 0x3f, 0x4f, 0xe8, 0x55, 0xa9, 0x78, 0xc2, 0xb4, 0x69, 0x04, 0xb3,
+  0x66, 0xfb, 0x79, 0xc2, 0x27, 0x62, 0x2e, 0x59, 0xde, 0x88, 0x2a, 0xad, 0xc5, 0x6d, 0xb1, 0xed,
+  0x47, 0x93, 0x64, 0x62, 0xa5, 0xa1, 0x83, 0x43, 0xc5, 0xcd, 0x12, 0x6f, 0xbf, 0xdf, 0xf7, 0x9a,
+  0x64, 0x4f, 0x3c, 0x4c, 0x36, 0xc5, 0xd3, 0x31, 0x5b, 0xb9, 0x6a, 0x3a, 0x76, 0xe9, 0xb3, 0x11,
+  0xc1, 0xe1, 0x64, 0xe3, 0x4d, 0x14, 0x5c, 0x2b, 0xca, 0x9d, 0x8b, 0xf3, 0x58, 0x27, 0x4a, 0x54,
+  0x66, 0xda, 0xc1, 0x59, 0xa5, 0x0d, 0x3c, 0x82, 0x09, 0x4a, 0xc0, 0x64, 0x0a, 0x69, 0x99, 0xd4,
+  0x05, 0x0e, 0xaf, 0xee, 0x9c, 0x9b, 0x97, 0x39, 0xa7, 0xcf, 0xa3, 0xf5, 0x9b, 0x34, 0x10, 0x69,
+  0x38, 0xea, 0x74, 0x98, 0x5e, 0xcb, 0x04, 0xb2, 0x5a, 0x26, 0x46, 0x94, 0x12, 0xdb, 0x2b, 0x53,
+  0x5c, 0x2f, 0x4e, 0x0c, 0x33, 0xb5, 0x0e, 0x42, 0xb8, 0xa0, 0xf2, 0xb4, 0x80, 0x1a, 0x01, 0xd9,
+  0x92, 0x09, 0x03, 0x81, 0x5b, 0x32, 0x6e, 0x92, 0x45, 0xe0, 0xf7, 0x58, 0x25, 0xb0, 0x8e, 0x88,
+  0xdf, 0x0f, 0xc3, 0xee, 0x4f, 0xba, 0x94, 0x01, 0x02, 0x03, 0x3c, 0x0a, 0x7c, 0x57, 0x20, 0x7e,
+  0xd8, 0x35, 0x7c, 0x65, 0x9e, 0xbb, 0x19, 0x8a, 0x30, 0xba, 0xeb, 0x0e, 0xde, 0xa4, 0x0d, 0x5f,
+  0x9b, 0xe8, 0x3b, 0x38, 0xdb, 0xa3, 0x63, 0xae, 0x12, 0xa2, 0x3d, 0x05, 0xff, 0xb1, 0xdf, 0x88,
+  0x51, 0x9a, 0xef, 0x10, 0x21, 0xb2, 0x73, 0xa0, 0xe1, 0x6b, 0xb3, 0x7a, 0x07, 0x6f, 0x7b, 0x04,
+  0x87, 0x70, 0xf6, 0xe8, 0x62, 0xbb, 0xef, 0xe2, 0x4f, 0xf9, 0x4a, 0xac, 0x78, 0x1a, 0xc4, 0xe1,
+  0xe6, 0xd3, 0x5f, 0xcf, 0xe1, 0xd3, 0x3f, 0x70, 0x8d, 0x41, 0x6d, 0x1e, 0x83, 0xc2, 0xc8, 0x9f,
+  0xc1, 0x10, 0x7c, 0x59, 0x4a, 0xde, 0x5a, 0x45, 0x85, 0x70, 0x87, 0x26, 0x22, 0x93, 0xf5, 0x90,
+  0x1e, 0x15, 0x2d, 0x2b, 0xa5, 0xf3, 0x16, 0xeb, 0xd9, 0x2b, 0xa1, 0x8a, 0x25, 0x53, 0xdc, 0xe9,
+  0x6b, 0x36, 0xef, 0xb8, 0xd2, 0x98, 0xa0, 0x0d, 0xd9, 0x51, 0x57, 0x78, 0xf4, 0x96, 0x99, 0x45,
+  0xd7, 0xce, 0x83, 0x40, 0x77, 0xeb, 0xca, 0x88, 0x82, 0x43, 0x0f, 0xf6, 0xfa, 0xe1, 0x86, 0x46,
+  0x22, 0xb1, 0x9d, 0xc1, 0x53, 0x5b, 0xb8, 0x67, 0x6f, 0xbf, 0x3d, 0x3d, 0xb5, 0x60, 0xc5, 0xcf,
+  0x86, 0x14, 0x49, 0x9e, 0x18, 0x9e, 0xa2, 0xcb, 0x7e, 0xd2, 0x6e, 0x7c, 0xf2, 0x02, 0x47, 0x9c,
+  0xf4, 0x37, 0x97, 0x9e, 0x2a, 0xce, 0x5f, 0x73, 0x56, 0x6d, 0xe0, 0x08, 0xe8, 0xfb, 0x6c, 0xd4,
+  0xd9, 0x74, 0x3a, 0xbd, 0x1e, 0x1c, 0x09, 0xc9, 0xd4, 0x1a, 0x16, 0x98, 0x98, 0x52, 0xe1, 0xb0,
+  0x3b, 0x80, 0xd9, 0xda, 0x70, 0x0d, 0x15, 0xde, 0x16, 0x9a, 0xe1, 0xc0, 0xe6, 0x3b, 0x90, 0x0b,
+  0x83, 0xb7, 0x5d, 0xc4, 0x65, 0x2a, 0x98, 0x24, 0xa1, 0x5a, 0x48, 0xb3, 0x3b, 0x00, 0x6b, 0xe6,
+  0xaf, 0x76, 0x17, 0xef, 0x61, 0xfc, 0x96, 0xcd, 0xe6, 0x80, 0xa4, 0x6d, 0x82, 0xdb, 0x7d, 0x96,
+  0xb3, 0xb9, 0x86, 0x20, 0xc6, 0x88, 0x50, 0x42, 0xa1, 0x94, 0xe1, 0x3d, 0xc5, 0xfa, 0xda, 0x19,
+  0x72, 0xad, 0x5a, 0xe9, 0xea, 0x46, 0x49, 0x89, 0xff, 0x5f, 0x30, 0xc3, 0xde, 0xe1, 0x36, 0xb8,
+  0xb7, 0x7a, 0x1b, 0x4f, 0x0e, 0x31, 0xb7, 0x05, 0x33, 0x93, 0x99, 0x90, 0x54, 0xc9, 0x4c, 0x29,
+  0xb6, 0x3e, 0xaa, 0xb3, 0x8c, 0xab, 0x20, 0xb4, 0x15, 0xdd, 0x34, 0x82, 0x75, 0x91, 0xda, 0xe1,
+  0xfd, 0x07, 0xa2, 0xa2, 0x14, 0x04, 0x39, 0x37, 0x20, 0x90, 0x84, 0x17, 0x24, 0x65, 0xf9, 0x00,
+  0xc6, 0x13, 0x6b, 0x43, 0x97, 0x42, 0xf3, 0x35, 0x97, 0x73, 0xb3, 0xb0, 0x27, 0x13, 0x38, 0x70,
+  0x66, 0x42, 0x8b, 0x83, 0xe5, 0xaa, 0x17, 0xc1, 0x45, 0xeb, 0xff, 0xd0, 0x89, 0x61, 0xaf, 0x7e,
+  0x4f, 0x61, 0x08, 0x08, 0x6d, 0x2f, 0xdc, 0xb1, 0x31, 0xb8, 0xeb, 0x6c, 0x3f, 0x84, 0x2f, 0x20,
+  0x86, 0x8d, 0x35, 0x10, 0xf3, 0xd3, 0x5a, 0xd9, 0x8c, 0x9b, 0x09, 0x95, 0x99, 0x9d, 0x37, 0x3e,
+  0x82, 0x24, 0x66, 0x85, 0x14, 0x77, 0x44, 0x30, 0xb6, 0xe8, 0x56, 0x26, 0xf0, 0x07, 0xa9, 0x7f,
+  0xc5, 0xc3, 0xe5, 0x96, 0xa9, 0x79, 0xe2, 0x2c, 0xb6, 0x14, 0x37, 0xa9, 0x2c, 0xb3, 0x59, 0x75,
+  0x93, 0x9c, 0x33, 0xf5, 0x1d, 0x96, 0x50, 0xd0, 0xdf, 0x01, 0xfc, 0x5d, 0x22, 0xaf, 0x45, 0x12,
+  0x19, 0x04, 0x0f, 0x5a, 0x17, 0x73, 0x1b, 0x80, 0x10, 0x13, 0x86, 0xad, 0x2c, 0xb7, 0x8a, 0xc8,
+  0x1a, 0x41, 0x33, 0xea, 0x3a, 0x23, 0x4c, 0xd1, 0xa3, 0x43, 0x3c, 0x79, 0x02, 0xc1, 0x12, 0x22,
+  0x88, 0x43, 0xac, 0xec, 0xe0, 0x06, 0x8f, 0x25, 0xd3, 0x8b, 0xa4, 0xd3, 0x98, 0x92, 0x89, 0x3c,
+  0x3f, 0xa1, 0xfb, 0x0c, 0x41, 0xfd, 0x87, 0xb3, 0x59, 0xca, 0xb3, 0x99, 0x6d, 0xb4, 0x56, 0x10,
+  0x13, 0xf5, 0x92, 0x61, 0xd2, 0x03, 0x8d, 0x6f, 0xb6, 0x90, 0xd4, 0x5e, 0x58, 0x33, 0xdd, 0xc4,
+  0x08, 0x2f, 0x41, 0xac, 0x3b, 0xab, 0x00, 0x59, 0x50, 0x87, 0xf5, 0x6a, 0xd7, 0x7a, 0x65, 0x83,
+  0xdc, 0x28, 0xd3, 0x46, 0x95, 0x1f, 0xf9, 0x56, 0x9d, 0x7b, 0x59, 0xf9, 0x6d, 0x58, 0x72, 0x21,
+  0xf9, 0x0f, 0x14, 0x3a, 0x3c, 0x1c, 0xb4, 0xc4, 0x19, 0xc7, 0xab, 0xf9, 0x18, 0xdb, 0xd6, 0xcd,
+  0xc7, 0xfb, 0xcd, 0x42, 0xe6, 0xf7, 0x82, 0xda, 0x93, 0x60, 0x4e, 0x4b, 0xdb, 0x9b, 0x45, 0x79,
+  0x4e, 0x9f, 0x1f, 0xac, 0x61, 0x94, 0x90, 0x88, 0x26, 0x5d, 0xd3, 0x33, 0x4f, 0x70, 0xdf, 0xa3,
+  0x67, 0x43, 0x53, 0xa7, 0x97, 0x06, 0x92, 0x26, 0x2c, 0x8a, 0x9b, 0x1d, 0x43, 0xad, 0x72, 0x73,
+  0xd4, 0xe3, 0x2b, 0x86, 0x3a, 0x22, 0x70, 0x81, 0x41, 0x57, 0x6f, 0xb5, 0xd7, 0x6d, 0x8e, 0x4d,
+  0xe7, 0x12, 0x70, 0xd4, 0xc1, 0x67, 0xf4, 0x1b, 0x2c, 0x27, 0x75, 0xce, 0xf2, 0xa0, 0x21, 0xe3,
+  0x7b, 0xec, 0x19, 0xbe, 0x93, 0xf0, 0x10, 0xaf, 0xac, 0xe6, 0x7a, 0xc2, 0xeb, 0xd1, 0x3d, 0x32,
+  0x7a, 0xee, 0x7d, 0xfe, 0x3f, 0x16, 0xc3, 0x81, 0xb2, 0xb0, 0x0b, 0x00, 0x00,
+};
+const size_t STATUS_PAGE_GZ_LEN = 1453;
+
+#endif  // STATUS_PAGE_HTML_H
@@ -0,0 +1,124 @@
+"""
+Smart Garden System - Sensor Storage Keys
+
+Compact binary key layout for the GardenSensorDataV2 table:
+
+    pk (B, 12 bytes): blake2b-64(deviceId) | uint32 day number (UTC)
+    sk (B, 10 bytes): uint64 epoch milliseconds | uint16 tie-breaker
+
+Partitioning by device and day bounds the size of every partition, even
+for chatty devices, and makes a time-range query a handful of key-range
+queries (one per day) instead of a scan. Both keys are big-endian so byte
+order is time order.
+
+The tie-breaker keeps readings in the same millisecond apart: it holds the
+sub-millisecond microseconds of the source timestamp (shifted left one)
+and a low bit set for backfilled history samples, so neither two live
+readings nor a live reading and a backfilled one overwrite each other. It
+is derived from the source item, so rewriting an item is idempotent.
+
+Raw items carry an expiresAt TTL attribute RAW_RETENTION_DAYS after their
+sample time, the same window the retention compactor keeps in
+GardenSensorData, so DynamoDB deletes them without spending write capacity.
+"""
+
+import hashlib
+import os
+import struct
+from datetime import datetime, timedelta, timezone
+from decimal import Decimal
+
+from boto3.dynamodb.conditions import Key
+
+MS_PER_DAY = 86_400_000
+RAW_RETENTION_DAYS = int(os.environ.get('RAW_RETENTION_DAYS', '30'))
+
+_PK = struct.Struct('>8sI')
+_SK = struct.Struct('>QH')
+
+SK_HISTORY = 0x1  # Tie-breaker bit for backfilled history samples
+SK_TIE_MAX = 0xFFFF
+
+_EPOCH = datetime(1970, 1, 1, tzinfo=timezone.utc)
+
+
+def device_hash(device_id):
+    return hashlib.blake2b(device_id.encode('utf-8'), digest_size=8).digest()
+
+
+def partition_key(device_id, epoch_ms):
+    """Partition key for a device on the UTC day containing epoch_ms"""
+    return _PK.pack(device_hash(device_id), epoch_ms // MS_PER_DAY)
+
+
+def sort_key(epoch_ms, tie=0):
+    return _SK.pack(epoch_ms, tie)
+
+
+def decode_sort_key(sk):
+    """Epoch milliseconds from a sort key (accepts bytes or boto3 Binary)"""
+    return _SK.unpack(bytes(sk))[0]
+
+
+def iso_to_epoch_us(timestamp):
+    """
+    Convert a stored ISO timestamp to epoch microseconds
+
+    Timestamps without an offset were written by datetime.now() in Lambda,
+    which runs in UTC.
+    """
+    moment = datetime.fromisoformat(timestamp)
+    if moment.tzinfo is None:
+        moment = moment.replace(tzinfo=timezone.utc)
+    return (moment - _EPOCH) // timedelta(microseconds=1)
+
+
+def iso_to_epoch_ms(timestamp):
+    """Convert a stored ISO timestamp to epoch milliseconds"""
+    return iso_to_epoch_us(timestamp) // 1000
+
+
+def to_v2_item(item):
+    """
+    Re-key a GardenSensorData item for the V2 table
+
+    Args:
+        item: Item with deviceId and ISO timestamp (see build_sensor_item)
+
+    Returns:
+        dict: Same attributes plus binary pk/sk, numeric epochMs and the
+            expiresAt TTL (epoch seconds)
+    """
+    epoch_ms, sub_ms_us = divmod(iso_to_epoch_us(item['timestamp']), 1000)
+    tie = sub_ms_us << 1 | (SK_HISTORY if item.get('source') == 'history' else 0)
+    v2_item = dict(item)
+    v2_item['pk'] = partition_key(item['deviceId'], epoch_ms)
+    v2_item['sk'] = sort_key(epoch_ms, tie)
+    v2_item['epochMs'] = Decimal(epoch_ms)
+    v2_item['expiresAt'] = Decimal((epoch_ms + RAW_RETENTION_DAYS * MS_PER_DAY) // 1000)
+    return v2_item
+
+
+def query_range(table, device_id, start_ms, end_ms):
+    """
+    Yield a device's V2 items with start_ms <= time <= end_ms, in order
+
+    Args:
+        table: GardenSensorDataV2 Table resource
+        device_id: Device identifier
+        start_ms: Range start (epoch ms, inclusive)
+        end_ms: Range end (epoch ms, inclusive)
+    """
+    for day in range(start_ms // MS_PER_DAY, end_ms // MS_PER_DAY + 1):
+        pk = _PK.pack(device_hash(device_id), day)
+        kwargs = {
+            'KeyConditionExpression': Key('pk').eq(pk) &
+                                      Key('sk').between(sort_key(start_ms),
+                                                        sort_key(end_ms, SK_TIE_MAX))
+        }
+        while True:
+            response = table.query(**kwargs)
+            yield from response.get('Items', [])
+            if 'LastEvaluatedKey' not in response:
+                break
+            kwargs['ExclusiveStartKey'] = response['LastEvaluatedKey']
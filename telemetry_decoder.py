@@ -0,0 +1,153 @@
+"""
+Smart Garden System - Telemetry Decoder
+
+Fast decoding of garden/telemetry payloads for the ingest tier. Payloads are
+parsed into a simdjson DOM by a reused pysimdjson Parser, and only the known
+firmware fields are converted to Python objects; a payload carrying keys we
+don't know about is converted in full. Falls back to the json module when
+pysimdjson is not installed.
+
+Benchmark on a corpus of recorded payloads (one JSON document per line):
+    python telemetry_decoder.py recorded_payloads.jsonl
+"""
+
+import json
+import sys
+import time
+
+try:
+    import simdjson
+except ImportError:
+    simdjson = None
+
+# Fields published by publishSensorData() in the firmware
+TELEMETRY_FIELDS = (
+    'deviceId',
+    'soilMoisture',
+    'soilMv',
+    'soilTemp',
+    'moisturePercent',
+    'pumpStatus',
+    'timestamp',
+    'rssi',
+    'firmwareVersion',
+    'lat',
+    'lon',
+    'traceId',
+    'valveFault',
+    'zones',
+    'sampleFlags',
+)
+
+_parser = None
+
+
+def _get_parser():
+    # One parser per process; simdjson parsers reuse their internal buffers
+    global _parser
+    if _parser is None:
+        _parser = simdjson.Parser()
+    return _parser
+
+
+def decode_telemetry(payload):
+    """
+    Decode a raw telemetry payload into a record dict
+
+    Args:
+        payload: Raw JSON payload (bytes or str)
+
+    Returns:
+        dict: Decoded telemetry record
+
+    Raises:
+        ValueError: If the payload is not a JSON object
+    """
+    if simdjson is None:
+        return _decode_fallback(payload)
+
+    if isinstance(payload, str):
+        payload = payload.encode('utf-8')
+
+    obj = _get_parser().parse(payload)
+    if not isinstance(obj, simdjson.Object):
+        raise ValueError('Telemetry payload is not a JSON object')
+
+    # Fast path: every key is one we know, so read just those fields
+    record = {}
+    for field in TELEMETRY_FIELDS:
+        value = obj.get(field)
+        if value is not None:
+            record[field] = value
+
+    if len(record) != len(obj):
+        # Unknown schema - keep every field
+        record = obj.as_dict()
+
+    # Drop our reference so the parser can be reused for the next payload
+    del obj
+    return record
+
+
+def _decode_fallback(payload):
+    record = json.loads(payload)
+    if not isinstance(record, dict):
+        raise ValueError('Telemetry payload is not a JSON object')
+    return record
+
+
+def benchmark(payloads, rounds=5):
+    """
+    Compare decode_telemetry() against json.loads on a payload corpus
+
+    Args:
+        payloads: List of raw payloads (bytes)
+        rounds: Number of passes over the corpus
+
+    Returns:
+        dict: Messages/sec and MB/s for each decoder
+    """
+    total_bytes = sum(len(p) for p in payloads) * rounds
+    results = {}
+
+    for name, decode in (('json', _decode_fallback), ('telemetry_decoder', decode_telemetry)):
+        start = time.perf_counter()
+        for _ in range(rounds):
+            for payload in payloads:
+                decode(payload)
+        elapsed = time.perf_counter() - start
+
+        results[name] = {
+            'msgs_per_sec': len(payloads) * rounds / elapsed,
+            'mb_per_sec': total_bytes / elapsed / 1e6
+        }
+
+    return results
+
+
+def load_corpus(path):
+    """Read newline-delimited recorded payloads"""
+    with open(path, 'rb') as f:
+        return [line.strip() for line in f if line.strip()]
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("Usage: python telemetry_decoder.py <recorded_payloads.jsonl>")
+        sys.exit(1)
+
+    payloads = load_corpus(sys.argv[1])
+    if not payloads:
+        print("⚠️  Corpus is empty")
+        sys.exit(1)
+
+    print(f"📦 Corpus: {len(payloads)} payloads, simdjson "
+          f"{'enabled' if simdjson is not None else 'NOT installed'}")
+
+    for name, result in benchmark(payloads).items():
+        print(f"⏱️  {name:>18}: {result['msgs_per_sec']:>12,.0f} msg/s  "
+              f"{result['mb_per_sec']:>8.1f} MB/s")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,87 @@
+"""
+Smart Garden System - Ingest Pipeline Tests
+
+Exercises Shard.apply() in-process with the network calls stubbed out and
+queued commands sent inline.
+
+Usage:
+    python -m unittest test_ingest_pipeline
+"""
+
+import os
+import queue
+import tempfile
+import unittest
+from unittest import mock
+
+os.environ.setdefault('AWS_DEFAULT_REGION', 'us-east-1')
+
+import ingest_pipeline
+from action_log import ActionLog
+from metrics import MetricsRegistry
+
+
+def make_shard(log_dir):
+    """A single shard wired to in-process queues and a scratch action log"""
+    registry = MetricsRegistry(1, ingest_pipeline.COUNTERS, ingest_pipeline.HISTOGRAMS,
+                               ingest_pipeline.SHARD_GAUGES)
+    with mock.patch.object(ActionLog, 'for_shard',
+                           lambda shard_id: ActionLog(os.path.join(log_dir, 'shard-0.log'))):
+        shard = ingest_pipeline.Shard(0, [queue.Queue()], [queue.Queue()], [queue.Queue()],
+                                      queue.Queue(), registry, [0])
+    shard.log = mock.Mock()
+    return shard
+
+
+class ShardApplyTest(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+        self.shard = make_shard(self.tmp.name)
+        self.commands = []
+        patches = [
+            mock.patch.object(ingest_pipeline, 'send_pump_command',
+                              lambda action, *a, **k: self.commands.append(action) or True),
+            mock.patch.object(ingest_pipeline, 'log_action', lambda *a, **k: True),
+            mock.patch.object(ingest_pipeline, 'send_notification', lambda *a, **k: True),
+        ]
+        for patch in patches:
+            patch.start()
+            self.addCleanup(patch.stop)
+
+    def tearDown(self):
+        self.shard.action_log.close()
+        self.tmp.cleanup()
+
+    def apply(self, millis, moisture, pump='OFF'):
+        self.shard.apply({'deviceId': 'd1', 'timestamp': millis,
+                          'moisturePercent': moisture, 'pumpStatus': pump})
+        # Stand in for the command sender thread
+        while not self.shard.outbox.empty():
+            send, kwargs = self.shard.outbox.get_nowait()
+            send(**kwargs)
+
+    def test_reordered_record_is_ignored(self):
+        self.apply(5_000_000, 60)
+        self.apply(4_999_000, 10)  # Stolen record from a second earlier
+        self.assertEqual(self.shard.devices['d1']['moisture_percent'], 60)
+        self.assertEqual(self.commands, [])
+
+    def test_reboot_mid_stream_resumes_updates(self):
+        self.apply(5_000_000, 60)
+        self.apply(5_060_000, 55)
+        # Device rebooted: millis() starts over far below the last sample
+        self.apply(12_000, 10)
+        state = self.shard.devices['d1']
+        self.assertEqual(state['device_time'], 12_000)
+        self.assertEqual(state['moisture_percent'], 10)
+        self.assertEqual(self.commands, ['WATER_ON'])
+
+        # And keeps tracking the new boot
+        self.apply(72_000, 50, pump='ON')
+        self.assertEqual(state['moisture_percent'], 50)
+        self.assertEqual(state['pump_status'], 'ON')
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,193 @@
+/*
+ * Smart Garden System - Firmware Trace Buffer
+ *
+ * Fixed-size ring buffer of begin/end/instant/counter events for building
+ * a timeline of the main loop (MQTT, TLS, sampling, pump control). Recording
+ * an event is a timestamp read, one atomic index bump and a single event
+ * store (16 bytes on the ESP32, 24 on 64-bit hosts), so it can stay enabled
+ * in normal builds. When the ring is full the oldest events are overwritten.
+ *
+ * Builds for the ESP32 (Arduino) and on the host; on the host timestamps
+ * come from std::chrono and the core id is always 0.
+ *
+ * Usage:
+ *   TRACE_SCOPE("publish");            // begin now, end at end of scope
+ *   TRACE_BEGIN("connect"); ... TRACE_END("connect");
+ *   TRACE_INSTANT("loop.stall");
+ *   TRACE_COUNTER("heap", ESP.getFreeHeap());
+ *
+ * traceDumpStart()/traceDumpLine() write the buffer as text lines a few at a
+ * time (traceDump() does it in one go); trace_to_perfetto.py turns a
+ * captured serial log into Chrome/Perfetto trace JSON. Names must be
+ * string literals (only the pointer is stored). Define TRACE_ENABLED 0
+ * before including to compile all tracing out.
+ */
+
+#ifndef TRACE_BUFFER_H
+#define TRACE_BUFFER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+// Must be a power of two
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS 1024
+#endif
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static inline uint32_t traceNowMicros() { return micros(); }
+static inline uint8_t traceCore() { return (uint8_t)xPortGetCoreID(); }
+#else
+#include <chrono>
+static inline uint32_t traceNowMicros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static inline uint8_t traceCore() { return 0; }
+#endif
+
+enum TracePhase : uint8_t {
+  TRACE_PHASE_BEGIN = 'B',
+  TRACE_PHASE_END = 'E',
+  TRACE_PHASE_INSTANT = 'i',
+  TRACE_PHASE_COUNTER = 'C'
+};
+
+struct TraceEvent {
+  uint32_t timestamp;  // micros(), wraps every ~71 minutes
+  const char* name;
+  int32_t value;       // counter value
+  uint8_t phase;
+  uint8_t core;
+};
+
+struct TraceBuffer {
+  TraceEvent events[TRACE_BUFFER_EVENTS];
+  uint32_t head;       // total events ever recorded
+  volatile bool paused;
+};
+
+static TraceBuffer traceBuffer = {};
+
+enum TraceDumpStage : uint8_t {
+  TRACE_DUMP_IDLE,
+  TRACE_DUMP_HEADER,
+  TRACE_DUMP_EVENTS,
+  TRACE_DUMP_FOOTER
+};
+
+// Dump in progress; events [next, end) are still to be written
+struct TraceDumpState {
+  uint32_t next;
+  uint32_t end;
+  uint8_t stage;
+};
+
+static TraceDumpState traceDumpState = {};
+
+static inline void traceRecord(uint8_t phase, const char* name, int32_t value = 0) {
+  if (traceBuffer.paused) return;
+  uint32_t slot = __atomic_fetch_add(&traceBuffer.head, 1, __ATOMIC_RELAXED);
+  TraceEvent& event = traceBuffer.events[slot & (TRACE_BUFFER_EVENTS - 1)];
+  event.timestamp = traceNowMicros();
+  event.name = name;
+  event.value = value;
+  event.phase = phase;
+  event.core = traceCore();
+}
+
+struct TraceScope {
+  const char* name;
+  explicit TraceScope(const char* scopeName) : name(scopeName) {
+    traceRecord(TRACE_PHASE_BEGIN, name);
+  }
+  ~TraceScope() { traceRecord(TRACE_PHASE_END, name); }
+};
+
+// The dump is written as text lines, oldest event first:
+//   TRACE_DUMP <events> <overwritten>
+//   T <timestamp_us> <phase> <core> <value> <name>
+//   TRACE_DUMP_END
+// Recording is paused from traceDumpStart() until the last line has been
+// taken, then the buffer is cleared. Returns false if a dump is already
+// in progress.
+static inline bool traceDumpStart() {
+  if (traceDumpState.stage != TRACE_DUMP_IDLE) return false;
+  traceBuffer.paused = true;
+
+  uint32_t head = __atomic_load_n(&traceBuffer.head, __ATOMIC_ACQUIRE);
+  uint32_t count = head < TRACE_BUFFER_EVENTS ? head : TRACE_BUFFER_EVENTS;
+  traceDumpState.next = head - count;
+  traceDumpState.end = head;
+  traceDumpState.stage = TRACE_DUMP_HEADER;
+  return true;
+}
+
+static inline bool traceDumpActive() {
+  return traceDumpState.stage != TRACE_DUMP_IDLE;
+}
+
+// Format the next line of the dump into line. Returns false once the dump
+// is finished (or none was started), leaving line untouched.
+static inline bool traceDumpLine(char* line, size_t size) {
+  switch (traceDumpState.stage) {
+    case TRACE_DUMP_HEADER: {
+      uint32_t count = traceDumpState.end - traceDumpState.next;
+      snprintf(line, size, "TRACE_DUMP %lu %lu", (unsigned long)count,
+               (unsigned long)(traceDumpState.end - count));
+      traceDumpState.stage = TRACE_DUMP_EVENTS;
+      return true;
+    }
+    case TRACE_DUMP_EVENTS:
+      if (traceDumpState.next != traceDumpState.end) {
+        const TraceEvent& event =
+            traceBuffer.events[traceDumpState.next++ & (TRACE_BUFFER_EVENTS - 1)];
+        snprintf(line, size, "T %lu %c %u %ld %s",
+                 (unsigned long)event.timestamp, event.phase, event.core,
+                 (long)event.value, event.name ? event.name : "?");
+        return true;
+      }
+      traceDumpState.stage = TRACE_DUMP_FOOTER;
+      // Fall through
+    case TRACE_DUMP_FOOTER:
+      snprintf(line, size, "TRACE_DUMP_END");
+      traceDumpState.stage = TRACE_DUMP_IDLE;
+      traceBuffer.head = 0;
+      traceBuffer.paused = false;
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Write the whole dump at once (host tools; the firmware streams it)
+static inline void traceDump(void (*writeLine)(const char* line)) {
+  char line[96];
+  if (!traceDumpStart()) return;
+  while (traceDumpLine(line, sizeof(line))) {
+    writeLine(line);
+  }
+}
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_BEGIN(name) traceRecord(TRACE_PHASE_BEGIN, name)
+#define TRACE_END(name) traceRecord(TRACE_PHASE_END, name)
+#define TRACE_INSTANT(name) traceRecord(TRACE_PHASE_INSTANT, name)
+#define TRACE_COUNTER(name, value) traceRecord(TRACE_PHASE_COUNTER, name, (int32_t)(value))
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_BEGIN(name) do {} while (0)
+#define TRACE_END(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+#define TRACE_COUNTER(name, value) do {} while (0)
+#endif
+
+#endif  // TRACE_BUFFER_H
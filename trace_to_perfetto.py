@@ -0,0 +1,137 @@
+"""
+Smart Garden System - Firmware Trace Converter
+
+Converts trace dumps from the firmware (see trace_buffer.h) into Chrome
+trace JSON, which opens directly in https://ui.perfetto.dev or
+chrome://tracing. The input is a raw serial capture: lines outside the
+TRACE_DUMP ... TRACE_DUMP_END markers are ignored, and each dump in the
+file becomes its own process in the timeline.
+
+Usage:
+    python trace_to_perfetto.py serial.log [-o trace.json]
+"""
+
+import argparse
+import json
+import sys
+
+WRAP = 2**32  # micros() is 32-bit on the device
+
+
+def parse_dumps(lines):
+    """
+    Extract trace dumps from serial output
+
+    Args:
+        lines: Iterable of text lines
+
+    Returns:
+        list: One list of (timestamp_us, phase, core, value, name) per dump
+    """
+    dumps = []
+    current = None
+
+    for line in lines:
+        line = line.strip()
+        if line.startswith('TRACE_DUMP_END'):
+            if current is not None:
+                dumps.append(current)
+            current = None
+        elif line.startswith('TRACE_DUMP'):
+            current = []
+        elif current is not None and line.startswith('T '):
+            parts = line.split(' ', 5)
+            if len(parts) < 6:
+                continue  # line mangled on the wire
+            _, timestamp, phase, core, value, name = parts
+            try:
+                current.append((int(timestamp), phase, int(core), int(value), name))
+            except ValueError:
+                continue
+
+    return dumps
+
+
+def to_chrome_events(events, pid):
+    """
+    Convert one dump to Chrome trace events
+
+    Timestamps are unwrapped across micros() rollover and rebased to the
+    first event. End events whose begin was overwritten in the ring are
+    dropped so the timeline nests correctly.
+
+    Returns:
+        list: Chrome trace event dicts
+    """
+    chrome = [{'name': 'process_name', 'ph': 'M', 'pid': pid,
+               'args': {'name': f'garden device (dump {pid})'}}]
+    if not events:
+        return chrome
+
+    base = events[0][0]
+    offset = 0
+    previous = base
+    open_spans = {}
+    cores = set()
+
+    for timestamp, phase, core, value, name in events:
+        if timestamp < previous and previous - timestamp > WRAP // 2:
+            offset += WRAP
+        previous = timestamp
+        ts = timestamp + offset - base
+        cores.add(core)
+
+        event = {'name': name, 'ph': phase, 'ts': ts, 'pid': pid, 'tid': core}
+        if phase == 'B':
+            open_spans.setdefault(core, []).append(name)
+        elif phase == 'E':
+            stack = open_spans.get(core)
+            if not stack or name not in stack:
+                continue
+            while stack and stack.pop() != name:
+                pass
+        elif phase == 'i':
+            event['s'] = 't'
+        elif phase == 'C':
+            event['args'] = {name: value}
+        chrome.append(event)
+
+    for core in sorted(cores):
+        chrome.append({'name': 'thread_name', 'ph': 'M', 'pid': pid, 'tid': core,
+                       'args': {'name': f'core {core}'}})
+    return chrome
+
+
+def convert(lines):
+    """
+    Returns:
+        dict: Chrome trace JSON object for every dump in the capture
+    """
+    trace_events = []
+    for pid, events in enumerate(parse_dumps(lines), start=1):
+        trace_events.extend(to_chrome_events(events, pid))
+    return {'traceEvents': trace_events, 'displayTimeUnit': 'ms'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert firmware trace dumps to Perfetto JSON')
+    parser.add_argument('capture', help='Serial log containing TRACE_DUMP blocks')
+    parser.add_argument('-o', '--output', default='trace.json')
+    args = parser.parse_args()
+
+    with open(args.capture, errors='replace') as f:
+        trace = convert(f)
+
+    dumps = sum(1 for e in trace['traceEvents'] if e.get('name') == 'process_name')
+    if not dumps:
+        print(f"✗ No TRACE_DUMP blocks found in {args.capture}")
+        sys.exit(1)
+
+    with open(args.output, 'w') as f:
+        json.dump(trace, f)
+    print(f"✅ Wrote {len(trace['traceEvents'])} events from {dumps} dump(s) to {args.output}")
+    print("   Open it at https://ui.perfetto.dev")
+
+
+if __name__ == '__main__':
+    main()
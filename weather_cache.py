@@ -0,0 +1,206 @@
+"""
+Smart Garden System - Weather Cache
+
+Caches weather forecasts per geohash tile so nearby devices share one
+forecast and decisions don't fetch the weather API once per message. A
+refresh reports whether the decision-relevant part of the forecast changed,
+so callers can re-evaluate devices only when it matters.
+
+Tiles are keyed 'gh:<geohash>' (TILE_PREFIX); anything else is a city
+name. Devices without coordinates fall back to the fleet-wide LOCATION
+city.
+"""
+
+import os
+import time
+import zlib
+
+from lambda_garden_automation import LOCATION, TILE_PREFIX, get_weather_forecast
+
+WEATHER_TTL_SECONDS = int(os.environ.get('WEATHER_TTL_SECONDS', '600'))
+
+# Geohash precision 5 is roughly a 5km x 5km tile
+TILE_PRECISION = int(os.environ.get('WEATHER_TILE_PRECISION', '5'))
+
+# Tiles refresh up to this fraction of the TTL early, at a fixed per-tile
+# offset, so refreshes are spread out instead of hitting the API together
+REFRESH_SPREAD = 0.25
+
+# After a failed fetch, try the tile again this much later
+ERROR_RETRY_SECONDS = int(os.environ.get('WEATHER_ERROR_RETRY_SECONDS', '60'))
+
+# Forecast fields that feed make_watering_decision()
+DECISION_FIELDS = ('rain_probability', 'temperature')
+
+# Served for a tile nobody has fetched yet (same as running without an API key)
+NO_FORECAST = {'temperature': 25, 'humidity': 50, 'rain_probability': 0,
+               'description': 'unavailable'}
+
+GEOHASH_ALPHABET = '0123456789bcdefghjkmnpqrstuvwxyz'
+_GEOHASH_INDEX = {c: i for i, c in enumerate(GEOHASH_ALPHABET)}
+
+
+def geohash_encode(lat, lon, precision=TILE_PRECISION):
+    """
+    Encode a coordinate as a geohash tile
+
+    Args:
+        lat: Latitude in degrees
+        lon: Longitude in degrees
+        precision: Number of geohash characters
+
+    Returns:
+        str: Geohash, e.g. '9q8yy' for central San Francisco
+    """
+    lat_range = [-90.0, 90.0]
+    lon_range = [-180.0, 180.0]
+    chars = []
+    bits = 0
+    value = 0
+    even = True
+
+    while len(chars) < precision:
+        rng, coord = (lon_range, lon) if even else (lat_range, lat)
+        mid = (rng[0] + rng[1]) / 2
+        if coord >= mid:
+            value = (value << 1) | 1
+            rng[0] = mid
+        else:
+            value <<= 1
+            rng[1] = mid
+        even = not even
+
+        bits += 1
+        if bits == 5:
+            chars.append(GEOHASH_ALPHABET[value])
+            bits = value = 0
+
+    return ''.join(chars)
+
+
+def geohash_center(tile):
+    """
+    Decode a geohash tile to the coordinate at its center
+
+    Returns:
+        tuple: (lat, lon)
+    """
+    lat_range = [-90.0, 90.0]
+    lon_range = [-180.0, 180.0]
+    even = True
+
+    for char in tile:
+        value = _GEOHASH_INDEX[char]
+        for shift in range(4, -1, -1):
+            rng = lon_range if even else lat_range
+            mid = (rng[0] + rng[1]) / 2
+            if (value >> shift) & 1:
+                rng[0] = mid
+            else:
+                rng[1] = mid
+            even = not even
+
+    return (lat_range[0] + lat_range[1]) / 2, (lon_range[0] + lon_range[1]) / 2
+
+
+def is_tile(location):
+    """True if a location key is a geohash tile ('gh:9q8yy') rather than a city name"""
+    geohash = location[len(TILE_PREFIX):]
+    return (location.startswith(TILE_PREFIX) and bool(geohash)
+            and all(c in _GEOHASH_INDEX for c in geohash))
+
+
+def device_tile(record):
+    """
+    Weather location for a telemetry record
+
+    Returns:
+        str: Tile ('gh:<geohash>') if the device reports coordinates, else LOCATION
+    """
+    lat, lon = record.get('lat'), record.get('lon')
+    if lat is None or lon is None:
+        return LOCATION
+    return TILE_PREFIX + geohash_encode(float(lat), float(lon))
+
+
+def fetch_forecast(location):
+    """Fetch the forecast for a tile (at its center) or a city name"""
+    if is_tile(location):
+        lat, lon = geohash_center(location[len(TILE_PREFIX):])
+        return get_weather_forecast(lat=lat, lon=lon)
+    return get_weather_forecast(location)
+
+
+class WeatherCache:
+    """
+    Per-tile forecast cache with a fixed time-to-live
+
+    Args:
+        ttl_seconds: How long a forecast stays fresh
+        fetch: Function taking a tile/location and returning a forecast dict
+    """
+
+    def __init__(self, ttl_seconds=WEATHER_TTL_SECONDS, fetch=fetch_forecast):
+        self.ttl_seconds = ttl_seconds
+        self.fetch = fetch
+        self.entries = {}  # tile -> (forecast, refresh_due_at)
+        self.hits = 0
+        self.misses = 0
+
+    def get(self, location):
+        """
+        Return the cached forecast for a tile; never fetches
+
+        Keeping forecasts fresh is the refresher's job (refresh() and
+        put()), so a lookup is one dict probe. A stale entry is still
+        served until the refresher replaces it; an unknown tile gets
+        NO_FORECAST.
+        """
+        entry = self.entries.get(location)
+        if entry is not None:
+            self.hits += 1
+            return entry[0]
+
+        self.misses += 1
+        return NO_FORECAST
+
+    def put(self, location, forecast):
+        """Store a forecast fetched elsewhere (e.g. pushed by the refresher)"""
+        # Fixed per-tile phase within the spread window
+        phase = (zlib.crc32(location.encode('utf-8')) % 1000) / 1000
+        ttl = self.ttl_seconds * (1 - REFRESH_SPREAD * phase)
+        self.entries[location] = (forecast, time.monotonic() + ttl)
+
+    def refresh(self, location):
+        """
+        Fetch a fresh forecast for a tile
+
+        A failed fetch (get_weather_forecast's fallback defaults) is not
+        stored: the previous forecast stays in place and the tile is
+        retried after ERROR_RETRY_SECONDS, so an API blip can't look like
+        a forecast change and re-evaluate the fleet.
+
+        Returns:
+            tuple: (forecast dict, True if decision-relevant fields changed);
+                   (None, False) if the fetch failed
+        """
+        previous = self.entries.get(location)
+        forecast = self.fetch(location)
+        if forecast.get('fallback'):
+            kept = previous[0] if previous is not None else NO_FORECAST
+            self.entries[location] = (kept, time.monotonic() + ERROR_RETRY_SECONDS)
+            return None, False
+        self.put(location, forecast)
+
+        changed = previous is None or any(
+            previous[0].get(field) != forecast.get(field) for field in DECISION_FIELDS
+        )
+        return forecast, changed
+
+    def stale_locations(self, locations):
+        """Tiles (from the given iterable) whose forecast is due for refresh"""
+        now = time.monotonic()
+        return [
+            location for location in locations
+            if location not in self.entries or now >= self.entries[location][1]
+        ]